@@ -0,0 +1,104 @@
+#ifndef __BenchmarkHarness_h
+#define __BenchmarkHarness_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       BenchmarkHarness.h
+ *
+ *   @brief      Header file for BenchmarkHarness.cxx to declare the timing harness shared by both benchmarks
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+using namespace cv;
+
+/**
+ * The command line options shared by the benchmark executables.
+ */
+struct BenchmarkOptions {
+    BenchmarkOptions() : min_time_s(0.5), min_runs(5), tolerance(0.1) {
+        sizes.push_back("720p");
+        sizes.push_back("1080p");
+        sizes.push_back("4k");
+        sizes.push_back("8k");
+    }
+
+    double min_time_s;          // each benchmark runs for at least this long
+    int min_runs;               // and at least this many times
+    double tolerance;           // the fraction a median can grow by before it counts as a regression
+    string filter;              // only run benchmarks whose name contains this
+    string save_filename;       // write the results here as a baseline
+    string compare_filename;    // compare the results against this baseline
+    vector<string> sizes;
+};
+
+/**
+ * A named image size.
+ */
+struct BenchmarkSize {
+    string name;
+    Size size;
+};
+
+/**
+ * Parse the benchmark options. Throws the usage message on anything it does not understand.
+ *
+ * @param argc: The argument count given to main.
+ * @param argv: The arguments given to main.
+ */
+BenchmarkOptions parseBenchmarkOptions(int argc, char** argv);
+
+/**
+ * Look up the sizes named in the options: 720p, 1080p, 4k or 8k.
+ *
+ * @param options: The options naming the sizes.
+ */
+vector<BenchmarkSize> benchmarkSizes(const BenchmarkOptions& options);
+
+/**
+ * Times benchmarks, prints them, and saves or compares them against a baseline.
+ */
+class BenchmarkRunner {
+public:
+    explicit BenchmarkRunner(const BenchmarkOptions& options);
+
+    /**
+     * Time a benchmark. It is run once untimed to warm up, then until both the
+     * minimum time and the minimum runs are reached, and the median run is kept.
+     *
+     * @param name: The benchmark's name, unique within the executable.
+     * @param body: One run of the code being timed.
+     */
+    void run(const string& name, const function<void()>& body);
+
+    /**
+     * Save or compare the results as the options ask.
+     *
+     * @return 1 if any benchmark is slower than its baseline by more than the tolerance, 0 otherwise.
+     */
+    int finish();
+
+private:
+    struct Result {
+        string name;
+        double median_ms;
+        double min_ms;
+        int runs;
+    };
+
+    BenchmarkOptions options_;
+    vector<Result> results_;
+};
+
+#endif // __BenchmarkHarness_h
@@ -0,0 +1,90 @@
+#ifndef __BoundedQueue_h
+#define __BoundedQueue_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       BoundedQueue.h
+ *
+ *   @brief      A fixed capacity, blocking queue used to join the stages of a pipeline
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+template <typename T>
+class BoundedQueue {
+public:
+    /**
+     * @param capacity: The number of items the queue holds before push blocks.
+     */
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity ? capacity : 1), closed_(false) {}
+
+    /**
+     * Add an item, waiting for space if the queue is full.
+     *
+     * @param item: The item to add.
+     * @return false if the queue was closed and the item was dropped.
+     */
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+
+        if (closed_) {
+            return false;
+        }
+
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+
+        return true;
+    }
+
+    /**
+     * Remove the oldest item, waiting for one if the queue is empty.
+     *
+     * @param item: Where the removed item is placed.
+     * @return false once the queue is closed and has been drained.
+     */
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+
+        if (items_.empty()) {
+            return false;
+        }
+
+        item = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+
+        return true;
+    }
+
+    /**
+     * Stop accepting items and wake every waiting thread. Items already queued can still be popped.
+     */
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+private:
+    std::deque<T> items_;
+    size_t capacity_;
+    bool closed_;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+};
+
+#endif // __BoundedQueue_h
@@ -0,0 +1,72 @@
+#ifndef __Stats_h
+#define __Stats_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       Stats.h
+ *
+ *   @brief      Header file for Stats.cxx to declare the per-stage timers and the stats export, shared by both tools
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <string>
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+using namespace cv;
+
+// each tool lists its own stages, and their names, in its StatsStages.h
+#include "StatsStages.h"
+
+/**
+ * Start collecting stage timings. Until this is called the timers do nothing.
+ * The stats are written when the program exits, and every interval_s seconds if given.
+ *
+ * @param filename: The file the stats are written to, as CSV if it ends in .csv and JSON otherwise.
+ * @param interval_s: How often the file is rewritten while running, 0 to only write it at exit.
+ */
+void enableStats(const string& filename, double interval_s = 0);
+
+/**
+ * Whether enableStats has been called.
+ */
+bool statsEnabled();
+
+/**
+ * Add one timing to a stage's histogram. Safe to call from any thread.
+ *
+ * @param stage: The stage that was timed.
+ * @param ticks: How long it took, in getTickCount ticks.
+ */
+void recordStage(Stage stage, int64 ticks);
+
+/**
+ * Write the count, mean, p50, p95, p99, max and rate of every stage to the stats file.
+ */
+void writeStats();
+
+/**
+ * Times the scope it lives in as one sample of a stage.
+ */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Stage stage) : stage_(stage), start_(statsEnabled() ? getTickCount() : 0) {}
+
+    ~ScopedTimer() {
+        if (start_) {
+            recordStage(stage_, getTickCount() - start_);
+        }
+    }
+
+private:
+    Stage stage_;
+    int64 start_;
+};
+
+#endif // __Stats_h
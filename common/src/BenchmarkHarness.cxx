@@ -0,0 +1,217 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       BenchmarkHarness.cxx
+ *
+ *   @brief      Handle timing benchmarks and comparing them against a saved baseline
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <algorithm>
+#include <map>
+
+#include "BenchmarkHarness.h"
+
+static string benchmarkUsage(const string& exec_path) {
+    string error_message;
+    error_message  = "usage: ";
+    error_message += exec_path;
+    error_message += " [-sizes <720p,1080p,4k,8k>] [-filter <text>] [-min-time <seconds>] [-min-runs <n>]";
+    error_message += "\n        [-save <baseline.csv>] [-compare <baseline.csv> [-tolerance <fraction>]]";
+
+    return error_message;
+}
+
+BenchmarkOptions parseBenchmarkOptions(int argc, char** argv) {
+    BenchmarkOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        string temp = argv[i];
+
+        if (temp == "-sizes" && i + 1 < argc) {
+            options.sizes.clear();
+
+            stringstream names(argv[++i]);
+            string name;
+            while (getline(names, name, ',')) {
+                options.sizes.push_back(name);
+            }
+        } else if (temp == "-filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (temp == "-min-time" && i + 1 < argc) {
+            options.min_time_s = atof(argv[++i]);
+        } else if (temp == "-min-runs" && i + 1 < argc) {
+            options.min_runs = max(1, atoi(argv[++i]));
+        } else if (temp == "-save" && i + 1 < argc) {
+            options.save_filename = argv[++i];
+        } else if (temp == "-compare" && i + 1 < argc) {
+            options.compare_filename = argv[++i];
+        } else if (temp == "-tolerance" && i + 1 < argc) {
+            options.tolerance = atof(argv[++i]);
+        } else {
+            throw benchmarkUsage(argv[0]);
+        }
+    }
+
+    return options;
+}
+
+vector<BenchmarkSize> benchmarkSizes(const BenchmarkOptions& options) {
+    vector<BenchmarkSize> sizes;
+
+    for (size_t i = 0; i < options.sizes.size(); i++) {
+        BenchmarkSize size;
+        size.name = options.sizes[i];
+
+        if (size.name == "720p") {
+            size.size = Size(1280, 720);
+        } else if (size.name == "1080p") {
+            size.size = Size(1920, 1080);
+        } else if (size.name == "4k") {
+            size.size = Size(3840, 2160);
+        } else if (size.name == "8k") {
+            size.size = Size(7680, 4320);
+        } else {
+            string error_message;
+            error_message  = "Unknown size \"";
+            error_message += size.name;
+            error_message += "\". Use 720p, 1080p, 4k or 8k.";
+
+            throw error_message;
+        }
+
+        sizes.push_back(size);
+    }
+
+    return sizes;
+}
+
+BenchmarkRunner::BenchmarkRunner(const BenchmarkOptions& options)
+    : options_(options) {
+}
+
+void BenchmarkRunner::run(const string& name, const function<void()>& body) {
+    if (!options_.filter.empty() && name.find(options_.filter) == string::npos) {
+        return;
+    }
+
+    // the first run grows every buffer, so it is left out
+    body();
+
+    vector<double> times;
+    double total_ms = 0;
+    double frequency = getTickFrequency() / 1000;
+
+    while (total_ms < options_.min_time_s * 1000 || (int) times.size() < options_.min_runs) {
+        int64 start = getTickCount();
+        body();
+        double elapsed = (getTickCount() - start) / frequency;
+
+        times.push_back(elapsed);
+        total_ms += elapsed;
+    }
+
+    sort(times.begin(), times.end());
+
+    Result result;
+    result.name = name;
+    result.median_ms = times[times.size() / 2];
+    result.min_ms = times.front();
+    result.runs = (int) times.size();
+    results_.push_back(result);
+
+    cout << left << setw(48) << name << right << fixed << setprecision(3)
+         << setw(12) << result.median_ms << " ms median"
+         << setw(12) << result.min_ms << " ms min"
+         << setw(8) << result.runs << " runs" << endl;
+}
+
+int BenchmarkRunner::finish() {
+    if (!options_.save_filename.empty()) {
+        ofstream out(options_.save_filename.c_str());
+
+        if (!out) {
+            string error_message;
+            error_message  = "Could not write the baseline \"";
+            error_message += options_.save_filename;
+            error_message += "\".";
+
+            throw error_message;
+        }
+
+        out << "name,median_ms,min_ms,runs" << endl << fixed << setprecision(6);
+        for (size_t i = 0; i < results_.size(); i++) {
+            out << results_[i].name << "," << results_[i].median_ms << ","
+                << results_[i].min_ms << "," << results_[i].runs << endl;
+        }
+    }
+
+    if (options_.compare_filename.empty()) {
+        return 0;
+    }
+
+    ifstream in(options_.compare_filename.c_str());
+    if (!in) {
+        string error_message;
+        error_message  = "Could not read the baseline \"";
+        error_message += options_.compare_filename;
+        error_message += "\".";
+
+        throw error_message;
+    }
+
+    map<string, double> baseline;
+    string line;
+    getline(in, line); // header
+
+    while (getline(in, line)) {
+        stringstream fields(line);
+        string name, median;
+
+        if (getline(fields, name, ',') && getline(fields, median, ',')) {
+            baseline[name] = atof(median.c_str());
+        }
+    }
+
+    int regressions = 0;
+
+    cout << endl << setprecision(1) << "against " << options_.compare_filename << " (tolerance "
+         << options_.tolerance * 100 << "%):" << endl;
+
+    for (size_t i = 0; i < results_.size(); i++) {
+        const Result& result = results_[i];
+        map<string, double>::const_iterator previous = baseline.find(result.name);
+
+        cout << left << setw(48) << result.name << right;
+
+        if (previous == baseline.end() || previous->second <= 0) {
+            cout << "         new" << endl;
+            continue;
+        }
+
+        double change = result.median_ms / previous->second - 1;
+        cout << setw(11) << showpos << change * 100 << noshowpos << "%";
+
+        if (change > options_.tolerance) {
+            cout << "  SLOWER";
+            ++regressions;
+        } else if (change < -options_.tolerance) {
+            cout << "  faster";
+        }
+        cout << endl;
+    }
+
+    cout << regressions << " regression" << (regressions == 1 ? "" : "s") << endl;
+
+    return regressions ? 1 : 0;
+}
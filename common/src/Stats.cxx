@@ -0,0 +1,199 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       Stats.cxx
+ *
+ *   @brief      Handle collecting stage timings into histograms and writing them out
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <atomic>
+#include <mutex>
+
+#include "Stats.h"
+
+namespace {
+
+// timings are bucketed by nanoseconds: exact below 8, then 8 buckets per power of two (within 12.5%)
+const int SUB_BUCKETS = 8;
+const int MAX_EXPONENT = 46;
+const int BUCKETS = (MAX_EXPONENT - 1) * SUB_BUCKETS;
+
+struct StageHistogram {
+    atomic<unsigned long long> buckets[BUCKETS];
+    atomic<unsigned long long> total_ns;
+    atomic<unsigned long long> max_ns;
+};
+
+StageHistogram histograms[STAGE_COUNT];
+atomic<bool> enabled(false);
+string stats_filename;
+int64 start_ticks = 0;
+int64 interval_ticks = 0;
+atomic<int64> next_write(0);
+mutex write_mutex;
+
+int bucketIndex(unsigned long long ns) {
+    if (ns < SUB_BUCKETS) {
+        return (int) ns;
+    }
+
+    int exponent;
+    frexp((double) ns, &exponent);
+    --exponent;
+    if (exponent > MAX_EXPONENT) {
+        return BUCKETS - 1;
+    }
+
+    int sub = (int) (ns >> (exponent - 3)) & (SUB_BUCKETS - 1);
+
+    return (exponent - 2) * SUB_BUCKETS + sub;
+}
+
+double bucketMidpoint(int index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+
+    int exponent = index / SUB_BUCKETS + 2;
+    int sub = index % SUB_BUCKETS;
+    double width = (double) (1ULL << (exponent - 3));
+
+    return (SUB_BUCKETS + sub) * width + width / 2;
+}
+
+struct StageSummary {
+    unsigned long long count;
+    double mean_ms, p50_ms, p95_ms, p99_ms, max_ms;
+};
+
+StageSummary summarise(const StageHistogram& histogram) {
+    StageSummary summary = StageSummary();
+    unsigned long long counts[BUCKETS];
+    unsigned long long count = 0;
+
+    // buckets are read one at a time while other threads keep adding, so total them here
+    for (int i = 0; i < BUCKETS; i++) {
+        counts[i] = histogram.buckets[i].load(memory_order_relaxed);
+        count += counts[i];
+    }
+
+    summary.count = count;
+    if (count == 0) {
+        return summary;
+    }
+
+    double percentiles[3] = { 0.50, 0.95, 0.99 };
+    double* results[3] = { &summary.p50_ms, &summary.p95_ms, &summary.p99_ms };
+    unsigned long long seen = 0;
+    int next = 0;
+
+    for (int i = 0; i < BUCKETS && next < 3; i++) {
+        seen += counts[i];
+        while (next < 3 && seen >= percentiles[next] * count) {
+            *results[next++] = bucketMidpoint(i) / 1e6;
+        }
+    }
+
+    summary.mean_ms = histogram.total_ns.load(memory_order_relaxed) / 1e6 / count;
+    summary.max_ms = histogram.max_ns.load(memory_order_relaxed) / 1e6;
+
+    return summary;
+}
+
+void writeStatsAtExit() {
+    writeStats();
+}
+
+} // namespace
+
+void enableStats(const string& filename, double interval_s) {
+    stats_filename = filename;
+    start_ticks = getTickCount();
+    interval_ticks = (int64) (interval_s * getTickFrequency());
+    next_write = start_ticks + interval_ticks;
+
+    if (!enabled.exchange(true)) {
+        atexit(writeStatsAtExit);
+    }
+}
+
+bool statsEnabled() {
+    return enabled.load(memory_order_relaxed);
+}
+
+void recordStage(Stage stage, int64 ticks) {
+    StageHistogram& histogram = histograms[stage];
+    unsigned long long ns = (unsigned long long) (ticks * (1e9 / getTickFrequency()));
+
+    histogram.buckets[bucketIndex(ns)].fetch_add(1, memory_order_relaxed);
+    histogram.total_ns.fetch_add(ns, memory_order_relaxed);
+
+    unsigned long long worst = histogram.max_ns.load(memory_order_relaxed);
+    while (ns > worst && !histogram.max_ns.compare_exchange_weak(worst, ns, memory_order_relaxed)) {
+    }
+
+    if (interval_ticks > 0) {
+        int64 now = getTickCount();
+        int64 due = next_write.load(memory_order_relaxed);
+
+        // whichever thread moves the deadline on does the write
+        if (now >= due && next_write.compare_exchange_strong(due, now + interval_ticks)) {
+            writeStats();
+        }
+    }
+}
+
+void writeStats() {
+    if (!statsEnabled()) {
+        return;
+    }
+
+    lock_guard<mutex> lock(write_mutex);
+
+    double elapsed_s = (getTickCount() - start_ticks) / getTickFrequency();
+    bool csv = stats_filename.size() >= 4 && stats_filename.compare(stats_filename.size() - 4, 4, ".csv") == 0;
+
+    ofstream out(stats_filename.c_str());
+    if (!out) {
+        cerr << "warning: could not write the stats to \"" << stats_filename << "\"" << endl;
+        return;
+    }
+    out << fixed << setprecision(3);
+
+    if (csv) {
+        out << "stage,count,mean_ms,p50_ms,p95_ms,p99_ms,max_ms,per_second" << endl;
+    } else {
+        out << "{" << endl << "  \"elapsed_s\": " << elapsed_s << "," << endl << "  \"stages\": {" << endl;
+    }
+
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        StageSummary s = summarise(histograms[stage]);
+        double rate = elapsed_s > 0 ? s.count / elapsed_s : 0;
+
+        if (csv) {
+            out << STAGE_NAMES[stage] << "," << s.count << "," << s.mean_ms << "," << s.p50_ms << ","
+                << s.p95_ms << "," << s.p99_ms << "," << s.max_ms << "," << rate << endl;
+        } else {
+            out << "    \"" << STAGE_NAMES[stage] << "\": { \"count\": " << s.count
+                << ", \"mean_ms\": " << s.mean_ms << ", \"p50_ms\": " << s.p50_ms
+                << ", \"p95_ms\": " << s.p95_ms << ", \"p99_ms\": " << s.p99_ms
+                << ", \"max_ms\": " << s.max_ms << ", \"per_second\": " << rate << " }"
+                << (stage + 1 < STAGE_COUNT ? "," : "") << endl;
+        }
+    }
+
+    if (!csv) {
+        out << "  }" << endl << "}" << endl;
+    }
+}
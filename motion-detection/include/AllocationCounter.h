@@ -0,0 +1,87 @@
+#ifndef __AllocationCounter_h
+#define __AllocationCounter_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       AllocationCounter.h
+ *
+ *   @brief      Header file for AllocationCounter.cxx to declare the debug-build, per thread count of Mat buffer allocations
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <atomic>
+#include <cstddef>
+
+/*
+ * Only Mat buffers are counted, the ones made through Mat's allocator. The detection loop's
+ * own vectors, the tracker's grid and OpenCV's internal scratch space (its filter engines
+ * and AutoBuffers) come from the heap directly and are not counted, so a count of zero
+ * means no frame sized buffers are being made, not that nothing is allocated at all.
+ *
+ * Allocations are charged to the AllocationScope open on the thread that makes them, so a
+ * decoder, capture thread, display or another stream allocating at the same time is never
+ * counted against a frame. Threads that do part of a scope's work, such as parallel_for_
+ * bodies, join it with AllocationScope(AllocationScope::current()).
+ *
+ * Counting is compiled in only when COUNT_ALLOCATIONS is defined, which CMake does for
+ * Debug builds and the allocation test.
+ */
+
+/**
+ * Route every Mat allocation through a counting allocator. Does nothing unless
+ * COUNT_ALLOCATIONS is defined, call it once at the start of main.
+ */
+void installAllocationCounter();
+
+/**
+ * Whether this build counts allocations at all.
+ */
+bool allocationCounting();
+
+/**
+ * Counts the Mat buffers allocated on this thread, and on any thread that joins it, for as
+ * long as it is open. Scopes nest: the one opened last on a thread counts until it closes.
+ */
+class AllocationScope {
+public:
+    /**
+     * Open a scope with a count of its own.
+     */
+    AllocationScope();
+
+    /**
+     * Open a scope on this thread that adds to another scope's count.
+     *
+     * @param count: The count to add to, from current() on the thread that owns it. May be
+     *               null, which stops this thread counting until the scope closes.
+     */
+    explicit AllocationScope(std::atomic<size_t>* count);
+
+    ~AllocationScope();
+
+    /**
+     * The Mat buffers allocated so far. Always 0 when COUNT_ALLOCATIONS is not defined.
+     */
+    size_t count() const { return *count_; }
+
+    /**
+     * The count allocations on this thread are charged to, null outside any scope.
+     */
+    static std::atomic<size_t>* current();
+
+private:
+    AllocationScope(const AllocationScope&);
+    AllocationScope& operator=(const AllocationScope&);
+
+    std::atomic<size_t> own_count_;
+    std::atomic<size_t>* count_;
+    std::atomic<size_t>* previous_;
+};
+
+#endif // __AllocationCounter_h
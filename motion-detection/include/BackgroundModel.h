@@ -0,0 +1,114 @@
+#ifndef __BackgroundModel_h
+#define __BackgroundModel_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       BackgroundModel.h
+ *
+ *   @brief      Header file for BackgroundModel.cxx to declare the background models used by getForegroundMask
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <string>
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+using namespace cv;
+
+/**
+ * The background a frame is compared against. Models are seeded from the first
+ * frame, then given every later frame after it has been compared.
+ */
+class BackgroundModel {
+public:
+    virtual ~BackgroundModel() {}
+
+    /**
+     * Seed the model from the first frame of the video.
+     *
+     * @param first_frame: The BGR frame, or CV_8UC1 luma plane, to use as the initial background.
+     */
+    virtual void initialise(const Mat& first_frame);
+
+    /**
+     * Fold a frame into the model once it has been compared against the background.
+     *
+     * @param gray_frame: The single channel CV_8U gray frame.
+     */
+    void update(const Mat& gray_frame) { updateRows(gray_frame, Range(0, gray_frame.rows)); }
+
+    /**
+     * Fold a band of rows of a frame into the model. Bands that do not overlap can be updated in parallel.
+     *
+     * @param gray_frame: The whole single channel CV_8U gray frame.
+     * @param rows: The rows to update.
+     */
+    virtual void updateRows(const Mat& gray_frame, const Range& rows) = 0;
+
+    /**
+     * Take a region of a frame into the background outright, so whatever is there stops being detected.
+     *
+     * @param gray_frame: The single channel CV_8U gray frame.
+     * @param region: The region to copy, clipped to the frame.
+     */
+    virtual void absorb(const Mat& gray_frame, const Rect& region);
+
+    /**
+     * Whether update changes the background, so a model started part way through a video
+     * needs the frames before that point to catch up with one run from the start.
+     */
+    virtual bool adapts() const { return true; }
+
+    /**
+     * The current single channel CV_8U background.
+     */
+    const Mat& background() const { return background_; }
+
+protected:
+    Mat background_;
+};
+
+/**
+ * The first frame of the video, kept forever.
+ */
+class StaticBackground : public BackgroundModel {
+public:
+    void updateRows(const Mat& gray_frame, const Range& rows);
+    bool adapts() const { return false; }
+};
+
+/**
+ * An exponential running average of every frame, so slow lighting changes fade into the background.
+ * The average is kept in CV_32F and rounded into the 8-bit background as it is updated.
+ */
+class RunningAverageBackground : public BackgroundModel {
+public:
+    /**
+     * @param learning_rate: The weight given to each new frame, between 0 and 1.
+     */
+    explicit RunningAverageBackground(double learning_rate = 0.02);
+
+    void initialise(const Mat& first_frame);
+    void updateRows(const Mat& gray_frame, const Range& rows);
+    void absorb(const Mat& gray_frame, const Rect& region);
+
+private:
+    double learning_rate_;
+    Mat average_;
+};
+
+/**
+ * Create a background model by name.
+ *
+ * @param name: Either "static" or "average".
+ * @param learning_rate: The learning rate used by the adaptive models.
+ */
+Ptr<BackgroundModel> createBackgroundModel(const string& name, double learning_rate = 0.02);
+
+#endif // __BackgroundModel_h
@@ -0,0 +1,89 @@
+#ifndef __Blobs_h
+#define __Blobs_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       Blobs.h
+ *
+ *   @brief      Header file for Blobs.cxx to declare the run-length connected component extractor
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+using namespace cv;
+
+/**
+ * A horizontal run of set pixels in a mask, covering columns [start, end).
+ */
+struct MaskRun {
+    int row;
+    int start;
+    int end;
+};
+
+/**
+ * An 8-connected region of a mask and its raw spatial moments.
+ */
+struct Blob {
+    int area;           // pixel count, the m00 moment
+    Rect bounds;
+    Point2f centroid;
+    double m10;         // sum of x
+    double m01;         // sum of y
+    double m20;         // sum of x^2
+    double m11;         // sum of x*y
+    double m02;         // sum of y^2
+
+    /**
+     * The angle of the blob's major axis in radians, from its central second order moments.
+     */
+    double orientation() const;
+};
+
+/**
+ * Finds the blobs in a binary mask. The mask is run-length encoded in one scan, the runs
+ * are labelled with union-find and the statistics of every blob are gathered from the runs,
+ * so the cost follows the number of runs rather than the number of pixels.
+ * The working buffers keep their capacity, so an extractor reused every frame stops allocating.
+ */
+class BlobExtractor {
+public:
+    /**
+     * @param mask: The CV_8UC1 mask, any non-zero pixel is set.
+     * @param blobs: Output, one entry per 8-connected region.
+     * @param tiles: The number of horizontal tiles the encoding is split into on every core, 1 to encode serially.
+     */
+    void extract(const Mat& mask, vector<Blob>& blobs, int tiles = 1);
+
+    /**
+     * The runs of the last mask, in row order.
+     */
+    const vector<MaskRun>& runs() const { return runs_; }
+
+private:
+    vector<MaskRun> runs_;
+    vector<vector<MaskRun> > tile_runs_;
+    vector<int> row_start_;
+    vector<int> parent_;
+    vector<int> blob_index_;
+};
+
+/**
+ * Run-length encode the set pixels of a band of rows of a mask, appending to runs.
+ *
+ * @param mask: The CV_8UC1 mask.
+ * @param rows: The rows to encode.
+ * @param runs: The runs are appended here in row order.
+ */
+void encodeRuns(const Mat& mask, const Range& rows, vector<MaskRun>& runs);
+
+#endif // __Blobs_h
@@ -0,0 +1,60 @@
+#ifndef __ChangeMap_h
+#define __ChangeMap_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       ChangeMap.h
+ *
+ *   @brief      Header file for ChangeMap.cxx to declare the block change map that limits detection to active regions
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "BackgroundModel.h"
+#include "Detection.h"
+
+using namespace std;
+using namespace cv;
+
+// the width and height of the blocks the change map is made of
+static const int CHANGE_BLOCK = 16;
+
+/**
+ * Find the parts of a frame that have changed, as rectangles of whole blocks. A block is
+ * active when its mean absolute difference is over the threshold, and every active block
+ * also activates its 8 neighbours so motion that has just entered a block is not missed.
+ *
+ * @param sums: The CV_32S per-block sums from blockDifference.
+ * @param frame_size: The size of the frame the sums were taken from.
+ * @param mean_thresh: The mean absolute difference a block needs to be active.
+ * @param active: Output, CV_8U, 255 for each active block.
+ * @param regions: Output, the active blocks as rectangles in pixels. Empty when nothing changed.
+ */
+void activeRegions(const Mat& sums, Size frame_size, int mean_thresh, Mat& active, vector<Rect>& regions);
+
+/**
+ * The same mask as getForegroundMask, but the blur, difference, threshold and morphology
+ * only run on the regions the block change map marks as active. Everywhere else is left
+ * as background, and a frame with no active blocks skips them entirely. Each region is
+ * processed with a halo, so inside the regions the mask matches the full-frame one.
+ *
+ * The background learns from the unblurred gray frame, as it does with THRESHOLD_FIXED,
+ * and the normalised mode takes its range from the active regions only.
+ *
+ * @param background: The background model to compare against and update.
+ * @param next_frame: The BGR frame, or CV_8UC1 luma plane, to compare against the background.
+ * @param settings: The thresholds to detect with, including block_thresh.
+ * @param context: The buffers to work in. The mask is left in context.mask and the regions in context.regions.
+ */
+const Mat& getForegroundMaskBlocks(BackgroundModel& background, const Mat& next_frame,
+                                   const DetectionSettings& settings, DetectionContext& context);
+
+#endif // __ChangeMap_h
@@ -0,0 +1,152 @@
+#ifndef __Detection_h
+#define __Detection_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       Detection.h
+ *
+ *   @brief      Header file for Detection.cxx to declare the per-frame motion detection functions
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "BackgroundModel.h"
+#include "Blobs.h"
+#include "Tracker.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ * How the difference against the background is turned into a binary mask.
+ *
+ * THRESHOLD_NORMALISED: stretch the difference to 0-255 first, so the threshold is relative to the strongest motion.
+ * THRESHOLD_FIXED: threshold the raw difference, fused with the gray conversion into a single pass.
+ */
+enum ThresholdMode {
+    THRESHOLD_NORMALISED,
+    THRESHOLD_FIXED
+};
+
+/**
+ * The tunable parameters shared by every way of running the detector.
+ */
+struct DetectionSettings {
+    DetectionSettings() : fore_thresh(64), area_thresh(256), threshold_mode(THRESHOLD_NORMALISED), tiles(1),
+                          track(false), block_thresh(0) {}
+
+    int fore_thresh;
+    int area_thresh;
+    ThresholdMode threshold_mode;
+    int tiles; // horizontal tiles each frame is split into, 1 to process it serially
+    bool track; // follow regions across frames and absorb the ones that stop moving into the background
+    int block_thresh; // mean difference a block needs before it is processed, 0 to always process the whole frame
+
+};
+
+/**
+ * The buffers one stream reuses from frame to frame. Once they have grown to the
+ * frame size, detecting motion in a frame no longer allocates.
+ */
+struct DetectionContext {
+    /**
+     * @param elementSize: The size of the elliptical structuring element used by cleanBinaryImage.
+     */
+    explicit DetectionContext(int elementSize = 5);
+
+    Mat gray;
+    Mat blurred;
+    Mat difference;
+    Mat binary;
+    Mat mask;
+    Mat compared; // header onto whichever gray buffer was compared against the background
+
+
+    Mat open_element;
+    Mat close_element;
+
+    // the block change map, used by getForegroundMaskBlocks
+    Mat block_sums;
+    Mat block_active;
+    vector<Rect> regions;
+
+    BlobExtractor blob_extractor;
+    vector<Blob> blobs;
+    Tracker tracker;
+
+    // one of each per tile, used by the tiled functions
+    vector<Mat> tile_gray;
+    vector<Mat> tile_blur;
+    vector<Mat> tile_mask;
+    vector<Mat> tile_clean;
+    vector<int> tile_min;
+    vector<int> tile_max;
+
+    size_t frames;              // frames detected with this context
+    size_t frame_allocations;   // Mat buffers allocated during the last frame, with COUNT_ALLOCATIONS only
+    bool allocation_warned;
+};
+
+/**
+ * Remove speckle noise and fill small gaps in a binary image.
+ *
+ * @param aBinaryImage: The binary image to clean.
+ * @param elementSize: The size of the elliptical structuring element.
+ */
+Mat cleanBinaryImage(const Mat& aBinaryImage, int elementSize = 5);
+
+/**
+ * Remove speckle noise and fill small gaps in a binary image, into an existing buffer.
+ *
+ * @param aBinaryImage: The binary image to clean.
+ * @param output: Output, the cleaned image. Reallocated only if its size changes.
+ * @param close_element: The structuring element used to fill gaps.
+ * @param open_element: The structuring element used to remove speckles.
+ */
+void cleanBinaryImage(const Mat& aBinaryImage, Mat& output, const Mat& close_element, const Mat& open_element);
+
+/**
+ * Generate a binary mask of the pixels that differ from the background, then
+ * fold the frame into the background model.
+ *
+ * @param background: The background model to compare against and update.
+ * @param next_frame: The BGR frame, or CV_8UC1 luma plane, to compare against the background.
+ * @param aThreshold: The threshold applied to the difference.
+ * @param mode: Whether the difference is normalised before it is thresholded.
+ */
+Mat getForegroundMask(BackgroundModel& background, const Mat& next_frame, int aThreshold = 128,
+                      ThresholdMode mode = THRESHOLD_NORMALISED);
+
+/**
+ * As above, working in the buffers of a context. The mask is left in context.mask.
+ *
+ * @param background: The background model to compare against and update.
+ * @param next_frame: The BGR frame, or CV_8UC1 luma plane, to compare against the background.
+ * @param settings: The thresholds to detect with.
+ * @param context: The buffers to work in.
+ */
+const Mat& getForegroundMask(BackgroundModel& background, const Mat& next_frame,
+                             const DetectionSettings& settings, DetectionContext& context);
+
+/**
+ * Detect motion in a frame and draw boxes around the moving regions.
+ *
+ * @param background: The background model to compare against and update.
+ * @param frame: The BGR frame, or CV_8UC1 luma plane, to process.
+ * @param settings: The thresholds to detect with.
+ * @param context: The buffers to work in. Every region is left in context.blobs, including those under area_thresh.
+ * @param annotated: Output, the moving regions of the frame with boxes drawn around those over area_thresh,
+ *                   and the velocity of each track when settings.track is set.
+ */
+void detectMotion(BackgroundModel& background, const Mat& frame, const DetectionSettings& settings,
+                  DetectionContext& context, Mat& annotated);
+
+#endif // __Detection_h
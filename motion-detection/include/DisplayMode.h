@@ -0,0 +1,44 @@
+#ifndef __DisplayMode_h
+#define __DisplayMode_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       DisplayMode.h
+ *
+ *   @brief      Header file for DisplayMode.cxx to declare the interactive detection loop
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <string>
+#include <opencv2/opencv.hpp>
+
+#include "BackgroundModel.h"
+#include "Detection.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ * Run motion detection on a video and write the annotated frames out. With display on,
+ * detection runs on a worker thread and the calling thread only shows the newest result,
+ * so a slow window never holds up processing. The trackbars on the Foreground window
+ * change the area and foreground thresholds while it runs. Esc or q stops early.
+ *
+ * HighGUI windows belong to the thread that made them, so this has to be called from the main thread.
+ *
+ * @param input: The opened video or webcam. The first frame is used as the background.
+ * @param output_filename: The video the annotated frames are written to.
+ * @param background: The background model, seeded here from the first frame.
+ * @param settings: The thresholds to start with.
+ * @param display: Show the input, foreground and background windows.
+ */
+void runDisplay(VideoCapture& input, const string& output_filename, BackgroundModel& background,
+                const DetectionSettings& settings, bool display);
+
+#endif // __DisplayMode_h
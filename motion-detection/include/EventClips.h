@@ -0,0 +1,93 @@
+#ifndef __EventClips_h
+#define __EventClips_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       EventClips.h
+ *
+ *   @brief      Header file for EventClips.cxx to declare the output mode that only writes frames with motion
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "BackgroundModel.h"
+#include "Detection.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ * Writes the frames around motion to a separate clip per event, and nothing else.
+ * The last pre_roll idle frames are kept in a ring buffer so a clip starts a little
+ * before the motion, and a clip keeps going for post_roll idle frames after it.
+ * Idle frames outside those windows are never encoded.
+ */
+class EventClipWriter {
+public:
+    /**
+     * @param output_directory: The directory the clips are written to, as clip<first frame>.avi.
+     * @param fps: The frame rate of the clips.
+     * @param frame_size: The size of the frames.
+     * @param pre_roll: The idle frames kept before the motion.
+     * @param post_roll: The idle frames written after the motion.
+     */
+    EventClipWriter(const string& output_directory, double fps, Size frame_size, int pre_roll, int post_roll);
+
+    /**
+     * Write a frame to the current clip, start a clip, or hold the frame for the pre-roll.
+     *
+     * @param frame: The frame. It is swapped with a spare buffer rather than copied, so
+     *               afterwards it holds an old frame that can be read over.
+     * @param index: The frame's index in the video, used to name the clips.
+     * @param motion: Whether the frame has motion in it.
+     */
+    void write(Mat& frame, size_t index, bool motion);
+
+    /**
+     * Close the clip being written, if any.
+     */
+    void finish();
+
+    size_t clips() const { return clips_; }
+    size_t framesWritten() const { return frames_written_; }
+
+private:
+    string output_directory_;
+    double fps_;
+    Size frame_size_;
+    int post_roll_;
+    int post_left_;
+
+    VideoWriter writer_;
+    vector<Mat> ring_;
+    size_t ring_head_;
+    size_t ring_count_;
+
+    size_t clips_;
+    size_t frames_written_;
+};
+
+/**
+ * Run motion detection on a video, writing only the clips with motion in them and
+ * a binary metadata stream of the regions in each frame (see MetadataWriter).
+ *
+ * @param input: The opened video. The first frame is used as the background.
+ * @param output_directory: The directory the clips and metadata.bin are written to.
+ * @param background: The background model, seeded here from the first frame.
+ * @param settings: The thresholds to detect with. A frame has motion if a region is over area_thresh.
+ * @param pre_roll: The idle frames written before each event.
+ * @param post_roll: The idle frames written after each event.
+ */
+void runClips(VideoCapture& input, const string& output_directory, BackgroundModel& background,
+              const DetectionSettings& settings, int pre_roll, int post_roll);
+
+#endif // __EventClips_h
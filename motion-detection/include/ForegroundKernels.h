@@ -0,0 +1,70 @@
+#ifndef __ForegroundKernels_h
+#define __ForegroundKernels_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       ForegroundKernels.h
+ *
+ *   @brief      Header file for ForegroundKernels.cxx to declare the fused 8-bit kernels behind getForegroundMask
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+using namespace cv;
+
+/**
+ * Convert a frame to gray, difference it against the background and threshold it, in one pass.
+ * The gray conversion uses the same fixed-point weights as cvtColor(COLOR_BGR2GRAY).
+ *
+ * @param frame: The CV_8UC3 BGR frame, or a CV_8UC1 luma plane which is used as the gray frame as is.
+ * @param background: The CV_8UC1 background, the same size as the frame.
+ * @param gray: Output, the gray frame. Reallocated only if its size changes, or a header onto a luma frame.
+ * @param mask: Output, 255 where |gray - background| > aThreshold, 0 elsewhere.
+ * @param aThreshold: The fixed difference threshold.
+ */
+void fusedForegroundMask(const Mat& frame, const Mat& background, Mat& gray, Mat& mask, int aThreshold);
+
+/**
+ * Convert a frame to gray and sum the absolute difference against the background over
+ * each block, in one pass. Used to find the parts of a frame that can have changed.
+ *
+ * @param frame: The CV_8UC3 BGR frame, or a CV_8UC1 luma plane which is used as the gray frame as is.
+ * @param background: The CV_8UC1 background, the same size as the frame.
+ * @param gray: Output, the gray frame. Reallocated only if its size changes, or a header onto a luma frame.
+ * @param sums: Output, CV_32S, one sum per block. Blocks on the right and bottom edges may be partial.
+ * @param block: The width and height of a block in pixels.
+ */
+void blockDifference(const Mat& frame, const Mat& background, Mat& gray, Mat& sums, int block);
+
+/**
+ * Absolute difference of two CV_8UC1 images, tracking the smallest and largest difference in the same pass.
+ *
+ * @param gray: The gray frame.
+ * @param background: The background, the same size as the frame.
+ * @param difference: Output, |gray - background|.
+ * @param min_value: Output, the smallest difference.
+ * @param max_value: Output, the largest difference.
+ */
+void absDiffRange(const Mat& gray, const Mat& background, Mat& difference, int& min_value, int& max_value);
+
+/**
+ * Threshold a difference image as if it had first been normalised to 0-255 with NORM_MINMAX.
+ * The normalise is folded into a 256 entry lookup table, so the image is only read once.
+ *
+ * @param difference: The CV_8UC1 difference from absDiffRange.
+ * @param mask: Output, the binary mask.
+ * @param min_value: The smallest value in difference.
+ * @param max_value: The largest value in difference.
+ * @param aThreshold: The threshold applied to the normalised difference.
+ */
+void thresholdNormalised(const Mat& difference, Mat& mask, int min_value, int max_value, int aThreshold);
+
+#endif // __ForegroundKernels_h
@@ -0,0 +1,126 @@
+#ifndef __LatestMailbox_h
+#define __LatestMailbox_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       LatestMailbox.h
+ *
+ *   @brief      A single slot, latest-wins handover between a producer and a consumer thread
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <mutex>
+#include <utility>
+#include <condition_variable>
+
+/**
+ * Holds at most one item. Putting an item replaces any item that has not been
+ * taken yet, so the consumer always gets the newest one. Items are swapped in
+ * and out rather than copied, so the producer gets the old slot back to reuse.
+ */
+template <typename T>
+class LatestMailbox {
+public:
+    LatestMailbox() : full_(false), closed_(false), overwritten_(0) {}
+
+    /**
+     * Swap an item into the slot.
+     *
+     * @param item: The new item. Holds the previous contents of the slot afterwards.
+     * @return true if an item that had not been taken was overwritten.
+     */
+    bool put(T& item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        bool overwrote = full_;
+        std::swap(slot_, item);
+        full_ = true;
+
+        if (overwrote) {
+            ++overwritten_;
+        }
+        ready_.notify_one();
+
+        return overwrote;
+    }
+
+    /**
+     * Swap the newest item out of the slot, waiting for one if it is empty.
+     *
+     * @param item: Where the item is placed. Its old contents go back into the slot for reuse.
+     * @return false once the mailbox is closed and empty.
+     */
+    bool take(T& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [this] { return full_ || closed_; });
+
+        if (!full_) {
+            return false;
+        }
+
+        std::swap(slot_, item);
+        full_ = false;
+
+        return true;
+    }
+
+    /**
+     * Swap the newest item out of the slot if there is one, without waiting.
+     *
+     * @param item: Where the item is placed. Its old contents go back into the slot for reuse.
+     * @return false if the slot was empty.
+     */
+    bool tryTake(T& item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (!full_) {
+            return false;
+        }
+
+        std::swap(slot_, item);
+        full_ = false;
+
+        return true;
+    }
+
+    /**
+     * Wake the consumer. An item already in the slot can still be taken.
+     */
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        ready_.notify_all();
+    }
+
+    /**
+     * Whether close has been called.
+     */
+    bool isClosed() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return closed_;
+    }
+
+    /**
+     * The number of items replaced before they were taken.
+     */
+    size_t overwritten() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return overwritten_;
+    }
+
+private:
+    T slot_;
+    bool full_;
+    bool closed_;
+    size_t overwritten_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+};
+
+#endif // __LatestMailbox_h
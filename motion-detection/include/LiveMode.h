@@ -0,0 +1,43 @@
+#ifndef __LiveMode_h
+#define __LiveMode_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       LiveMode.h
+ *
+ *   @brief      Header file for LiveMode.cxx to declare the latency-budgeted live detection loop
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <string>
+#include <opencv2/opencv.hpp>
+
+#include "BackgroundModel.h"
+#include "Detection.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ * Run motion detection on a live feed, favouring fresh results over processing every frame.
+ * A capture thread keeps only the newest frame; frames replaced before they were picked
+ * up, or older than the latency budget when they are, are dropped and counted. The
+ * capture-to-result latency of every processed frame is printed.
+ *
+ * @param input: The opened feed. The first frame is used as the background.
+ * @param output_filename: The video the annotated frames are written to, empty to not write one.
+ * @param background: The background model, seeded here from the first frame.
+ * @param settings: The thresholds to detect with.
+ * @param budget_ms: The oldest a frame can be, in milliseconds, when processing starts.
+ * @param pace: Read no faster than the feed's frame rate, so a video file plays like a camera.
+ */
+void runLive(VideoCapture& input, const string& output_filename, BackgroundModel& background,
+             const DetectionSettings& settings, double budget_ms, bool pace);
+
+#endif // __LiveMode_h
@@ -0,0 +1,78 @@
+#ifndef __MotionMetadata_h
+#define __MotionMetadata_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       MotionMetadata.h
+ *
+ *   @brief      Header file for MotionMetadata.cxx to declare the binary per-frame region stream
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <utility>
+#include <opencv2/opencv.hpp>
+
+#include "Blobs.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ * Writes the regions found in each frame to a compact binary file. Every value is
+ * little-endian on the machines we run on (it is written in host byte order).
+ *
+ *   header:  char magic[8] = "MDMETA1", uint32 width, uint32 height, double fps
+ *   record:  uint64 frame, double timestamp_ms, uint32 count,
+ *            then count times: uint16 x, uint16 y, uint16 width, uint16 height, uint32 area
+ *   index:   one (double timestamp_ms, uint64 record offset) pair per record
+ *   footer:  uint64 index offset, uint64 index entries, char magic[8] = "MDINDEX"
+ *
+ * Only frames with a region over the area threshold get a record. The index is
+ * sorted by timestamp, so a reader can read the footer from the end of the file
+ * and binary search the index for the records around a time.
+ */
+class MetadataWriter {
+public:
+    /**
+     * @param filename: The file to create.
+     * @param frame_size: The size of the video's frames.
+     * @param fps: The video's frame rate.
+     */
+    MetadataWriter(const string& filename, Size frame_size, double fps);
+
+    /**
+     * Write the regions of one frame, if any are over the area threshold.
+     *
+     * @param frame: The frame's index in the video.
+     * @param timestamp_ms: The frame's time in the video.
+     * @param blobs: The regions found in the frame.
+     * @param area_thresh: Regions this size or smaller are left out.
+     * @return true if a record was written.
+     */
+    bool write(size_t frame, double timestamp_ms, const vector<Blob>& blobs, int area_thresh);
+
+    /**
+     * Write the index and footer and close the file. Called by the destructor if not called before.
+     */
+    void finish();
+
+    ~MetadataWriter();
+
+private:
+    template <typename T>
+    void put(const T& value) { out_.write((const char*) &value, sizeof(value)); }
+
+    ofstream out_;
+    vector<pair<double, unsigned long long> > index_;
+};
+
+#endif // __MotionMetadata_h
@@ -0,0 +1,57 @@
+#ifndef __MultiStream_h
+#define __MultiStream_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       MultiStream.h
+ *
+ *   @brief      Header file for MultiStream.cxx to declare running many videos through one shared worker pool
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <string>
+#include <vector>
+
+#include "Detection.h"
+
+using namespace std;
+
+/**
+ * One input to process and where its annotated video is written.
+ */
+struct StreamSource {
+    string input;   // a video file, a device index or "webcam"
+    string output;
+};
+
+/**
+ * Expand a list of inputs into streams. Any input ending in .txt is read as a
+ * manifest with one input per line, optionally followed by its output video.
+ * Streams without an output are written to output_directory/stream<n>.avi.
+ *
+ * @param inputs: The files, device indices and manifests to expand.
+ * @param output_directory: Where streams without an explicit output are written.
+ */
+vector<StreamSource> parseStreamSources(const vector<string>& inputs, const string& output_directory);
+
+/**
+ * Run motion detection over every stream on one shared pool of workers. Each
+ * stream keeps its own background model and is given one frame of work at a
+ * time in round-robin order, so a busy stream cannot starve the quiet ones.
+ *
+ * @param streams: The streams to process.
+ * @param background_model: The name passed to createBackgroundModel for every stream.
+ * @param learning_rate: The learning rate passed to createBackgroundModel.
+ * @param settings: The thresholds to detect with.
+ * @param workers: The number of worker threads, 0 for one per core.
+ */
+void runStreams(const vector<StreamSource>& streams, const string& background_model, double learning_rate,
+                const DetectionSettings& settings, size_t workers = 0);
+
+#endif // __MultiStream_h
@@ -0,0 +1,41 @@
+#ifndef __Pipeline_h
+#define __Pipeline_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       Pipeline.h
+ *
+ *   @brief      Header file for Pipeline.cxx to declare the headless decode -> detect -> encode pipeline
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <string>
+#include <opencv2/opencv.hpp>
+
+#include "BackgroundModel.h"
+#include "Detection.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ * Run motion detection over a whole video without a GUI. Decoding, detection and
+ * encoding each run on their own thread, joined by bounded queues, and the output
+ * is written through a single VideoWriter.
+ *
+ * @param input: The opened video to read from. The first frame is used as the background.
+ * @param output_filename: The video the annotated frames are written to.
+ * @param background: The background model, seeded here from the first frame.
+ * @param settings: The thresholds to detect with.
+ * @param queue_depth: The number of frames each queue holds between stages.
+ */
+void runPipeline(VideoCapture& input, const string& output_filename, BackgroundModel& background,
+                 const DetectionSettings& settings, size_t queue_depth = 8);
+
+#endif // __Pipeline_h
@@ -0,0 +1,175 @@
+#ifndef __RawInput_h
+#define __RawInput_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       RawInput.h
+ *
+ *   @brief      Header file for RawInput.cxx to declare reading raw frames from pipes and shared memory
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+#include "BackgroundModel.h"
+#include "Detection.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ * The layouts raw frames can arrive in.
+ *
+ * RAW_BGR: packed 8-bit BGR, the same as a decoded VideoCapture frame.
+ * RAW_Y8: an 8-bit luma plane only.
+ * RAW_NV12: a luma plane followed by an interleaved half-size UV plane.
+ * RAW_I420: a luma plane followed by half-size U and V planes.
+ *
+ * Only the luma plane of the YUV formats is used, so they are never converted to BGR.
+ */
+enum RawFormat {
+    RAW_BGR,
+    RAW_Y8,
+    RAW_NV12,
+    RAW_I420
+};
+
+/**
+ * Look up a raw format by name: bgr, y8, nv12 or i420.
+ *
+ * @param name: The name of the format.
+ */
+RawFormat parseRawFormat(const string& name);
+
+/**
+ * The size in bytes of one frame.
+ *
+ * @param format: The layout of the frame.
+ * @param size: The size of the frame. YUV 4:2:0 frames must have an even width and height.
+ */
+size_t rawFrameBytes(RawFormat format, Size size);
+
+/**
+ * A source of raw frames.
+ */
+class RawFrameSource {
+public:
+    virtual ~RawFrameSource() {}
+
+    /**
+     * Get the next frame.
+     *
+     * @param frame: Output, a header onto the frame: CV_8UC3 for RAW_BGR, the CV_8UC1 luma plane otherwise.
+     *               The data stays valid until the next call.
+     * @return false once the source has no more frames.
+     */
+    virtual bool read(Mat& frame) = 0;
+};
+
+/**
+ * Reads frames from stdin, a file or a named pipe. Each frame is read straight into one
+ * reused buffer, with no copy after the read itself.
+ */
+class PipeFrameSource : public RawFrameSource {
+public:
+    /**
+     * @param path: The file or named pipe to read, or "-" for stdin.
+     * @param format: The layout of the frames.
+     * @param size: The size of the frames.
+     */
+    PipeFrameSource(const string& path, RawFormat format, Size size);
+    ~PipeFrameSource();
+
+    bool read(Mat& frame);
+
+private:
+    int fd_;
+    bool owns_fd_;
+    RawFormat format_;
+    Size size_;
+    Mat buffer_;
+};
+
+/**
+ * The header at the start of a shared memory ring. A producer fills it in, then for each frame:
+ *
+ *   1. waits until written - read < slots,
+ *   2. writes the frame into slot (written % slots),
+ *   3. stores written + 1 into written.
+ *
+ * and sets closed after its last frame. The consumer only reads a slot after written has
+ * moved past it, and stores read once it is done with the slot, so a frame is never
+ * overwritten while it is being processed. Slot i starts at RAW_RING_DATA_OFFSET + i * frame_bytes.
+ */
+struct RawRingHeader {
+    char magic[8];                  // "RAWRING"
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;                // a RawFormat
+    uint32_t slots;
+    uint64_t frame_bytes;
+    atomic<uint64_t> written;       // frames published by the producer
+    atomic<uint64_t> read;          // frames released by the consumer
+    atomic<uint32_t> closed;        // set once the producer has published its last frame
+};
+
+static const size_t RAW_RING_DATA_OFFSET = 4096;
+
+/**
+ * Reads frames in place from a POSIX shared memory ring (see RawRingHeader). Frames are
+ * never copied: each one is a header straight onto its slot.
+ */
+class SharedMemoryFrameSource : public RawFrameSource {
+public:
+    /**
+     * @param name: The name of the shared memory object, as given to shm_open.
+     * @param format: The layout the frames are expected in. Checked against the ring's header.
+     * @param size: The size the frames are expected to be. Checked against the ring's header.
+     */
+    SharedMemoryFrameSource(const string& name, RawFormat format, Size size);
+    ~SharedMemoryFrameSource();
+
+    bool read(Mat& frame);
+
+private:
+    uchar* mapping_;
+    size_t mapping_bytes_;
+    RawRingHeader* header_;
+    RawFormat format_;
+    Size size_;
+    uint64_t next_;
+    bool holding_;
+};
+
+/**
+ * Open a raw frame source.
+ *
+ * @param source: "-" for stdin, "shm:<name>" for a shared memory ring, otherwise a file or named pipe.
+ * @param format: The layout of the frames.
+ * @param size: The size of the frames.
+ */
+Ptr<RawFrameSource> openRawSource(const string& source, RawFormat format, Size size);
+
+/**
+ * Run motion detection on raw frames until the source runs out.
+ *
+ * @param source: The frames. The first is used as the background.
+ * @param output_filename: The video the annotated frames are written to, empty to not write one.
+ *                         Luma-only input is written as a gray video.
+ * @param fps: The frame rate of the output video.
+ * @param background: The background model, seeded here from the first frame.
+ * @param settings: The thresholds to detect with.
+ */
+void runRaw(RawFrameSource& source, const string& output_filename, double fps, BackgroundModel& background,
+            const DetectionSettings& settings);
+
+#endif // __RawInput_h
@@ -0,0 +1,50 @@
+#ifndef __SegmentMode_h
+#define __SegmentMode_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       SegmentMode.h
+ *
+ *   @brief      Header file for SegmentMode.cxx to declare the segment-parallel processing of one video file
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <string>
+#include <opencv2/opencv.hpp>
+
+#include "Detection.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ * Run motion detection on a long video file using every core, by splitting it into time
+ * segments that are processed at the same time. Each segment opens the file itself and
+ * seeds its own background model from frame 0, read once for all of them, so a static
+ * background matches a serial run exactly. A background that adapts, or one that tracking
+ * absorbs regions into, also seeks to overlap frames before its start and runs over those
+ * frames without writing them, so it starts warmed up instead of from frame 0 alone.
+ *
+ * Each segment is written to output_directory/segment<n>.avi, and segments.txt lists them
+ * in order (in the format of ffmpeg's concat demuxer) so they can be joined without
+ * re-encoding. The regions of every segment are merged in order into
+ * output_directory/metadata.bin, in the format described in MotionMetadata.h.
+ *
+ * @param input_filename: The video file. It has to be seekable and report its frame count.
+ * @param output_directory: The directory the segments and metadata are written to.
+ * @param background_model: The name of the background model every segment creates.
+ * @param learning_rate: The learning rate of the background model.
+ * @param settings: The thresholds to detect with.
+ * @param segments: The number of segments, 0 for one per core.
+ * @param overlap: The frames before its start an adapting background warms up over.
+ */
+void runSegments(const string& input_filename, const string& output_directory, const string& background_model,
+                 double learning_rate, const DetectionSettings& settings, size_t segments, int overlap);
+
+#endif // __SegmentMode_h
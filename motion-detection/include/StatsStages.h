@@ -0,0 +1,40 @@
+#ifndef __StatsStages_h
+#define __StatsStages_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       StatsStages.h
+ *
+ *   @brief      The stages of motion detection that Stats.h times, and the names they are written under
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+/**
+ * The stages of the detector that are timed. STAGE_FRAME covers a whole call to detectMotion,
+ * so its rate is the frame throughput. When a frame is split into tiles or active regions
+ * the stages inside the frame are timed per tile or region.
+ */
+enum Stage {
+    STAGE_DECODE,
+    STAGE_CHANGE_MAP,
+    STAGE_GRAY_BLUR,
+    STAGE_DIFFERENCE,   // difference, normalisation and threshold, plus the gray conversion with -fixed
+    STAGE_MORPHOLOGY,
+    STAGE_BLOBS,
+    STAGE_DISPLAY,
+    STAGE_ENCODE,
+    STAGE_FRAME,
+    STAGE_COUNT
+};
+
+static const char* const STAGE_NAMES[STAGE_COUNT] = {
+    "decode", "change_map", "gray_blur", "difference", "morphology", "blobs", "display", "encode", "frame"
+};
+
+#endif // __StatsStages_h
@@ -0,0 +1,66 @@
+#ifndef __ThreadPool_h
+#define __ThreadPool_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       ThreadPool.h
+ *
+ *   @brief      Header file for ThreadPool.cxx to declare a fixed set of worker threads fed from one FIFO queue
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+class ThreadPool {
+public:
+    /**
+     * @param threads: The number of worker threads, 0 for one per core.
+     */
+    explicit ThreadPool(size_t threads = 0);
+
+    /**
+     * Finish every queued task, then join the workers.
+     */
+    ~ThreadPool();
+
+    /**
+     * Queue a task behind every task already waiting. Tasks may submit further tasks.
+     *
+     * @param task: The task to run on a worker.
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * Block until the queue is empty and no task is running.
+     */
+    void wait();
+
+    /**
+     * The number of worker threads.
+     */
+    size_t size() const { return workers_.size(); }
+
+private:
+    void work();
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()> > tasks_;
+    size_t active_;
+    bool stopping_;
+    std::mutex mutex_;
+    std::condition_variable task_ready_;
+    std::condition_variable idle_;
+};
+
+#endif // __ThreadPool_h
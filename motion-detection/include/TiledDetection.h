@@ -0,0 +1,44 @@
+#ifndef __TiledDetection_h
+#define __TiledDetection_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       TiledDetection.h
+ *
+ *   @brief      Header file for TiledDetection.cxx to declare the tile-parallel versions of the detection functions
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <opencv2/opencv.hpp>
+
+#include "BackgroundModel.h"
+#include "Detection.h"
+
+using namespace std;
+using namespace cv;
+
+// pixels either side of a region needed by the 5x5 median blur
+static const int MEDIAN_HALO = 5 / 2;
+// pixels either side of a region needed by cleanBinaryImage: close and open each dilate and erode with a 5x5 element
+static const int CLEAN_HALO = 4 * (5 / 2);
+
+/**
+ * The same mask as getForegroundMask, computed in horizontal tiles on every core.
+ * Each tile is processed with enough halo rows for the median blur and the
+ * morphology, so the result is bit-identical to the serial version.
+ *
+ * @param background: The background model to compare against and update.
+ * @param next_frame: The BGR frame, or CV_8UC1 luma plane, to compare against the background.
+ * @param settings: The thresholds to detect with and the number of tiles.
+ * @param context: The buffers to work in. The mask is left in context.mask.
+ */
+const Mat& getForegroundMaskTiled(BackgroundModel& background, const Mat& next_frame,
+                                  const DetectionSettings& settings, DetectionContext& context);
+
+#endif // __TiledDetection_h
@@ -0,0 +1,91 @@
+#ifndef __Tracker_h
+#define __Tracker_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       Tracker.h
+ *
+ *   @brief      Header file for Tracker.cxx to declare the multi-object tracker built on the blob output
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <vector>
+#include <unordered_map>
+#include <opencv2/opencv.hpp>
+
+#include "Blobs.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ * A blob followed from frame to frame.
+ */
+struct Track {
+    int id;
+    Point2f position;   // the blob's centroid
+    Point2f velocity;   // smoothed centroid movement, in pixels per frame
+    Rect bounds;
+    int area;
+    double orientation;
+    int age;            // frames since the track started
+    int missed;         // consecutive frames without a matching blob
+    int still;          // consecutive frames the centroid has barely moved
+};
+
+/**
+ * Associates blobs with tracks through a spatial hash of the tracks' predicted
+ * positions, so each blob only looks at the tracks in the neighbouring cells rather
+ * than every track. Tracks that stop moving are retired, so the caller can fold their
+ * regions into the background and stop detecting them.
+ */
+class Tracker {
+public:
+    /**
+     * @param match_distance: The furthest a blob can be from a track's predicted position and still match it.
+     * @param still_distance: Movement per frame below this counts as standing still.
+     * @param still_frames: The number of still frames after which a track is retired.
+     * @param max_missed: The number of frames a track survives without a matching blob.
+     */
+    Tracker(float match_distance = 50, float still_distance = 1.5f, int still_frames = 50, int max_missed = 5);
+
+    /**
+     * Match a frame's blobs to the tracks, start tracks for unmatched blobs and drop or retire old ones.
+     *
+     * @param blobs: The blobs found in the frame.
+     * @param min_area: Blobs this size or smaller are ignored.
+     */
+    void update(const vector<Blob>& blobs, int min_area);
+
+    /**
+     * The live tracks after the last update.
+     */
+    const vector<Track>& tracks() const { return tracks_; }
+
+    /**
+     * The bounds of the tracks retired for standing still in the last update.
+     */
+    const vector<Rect>& retired() const { return retired_; }
+
+private:
+    long long cellKey(const Point2f& point) const;
+
+    float match_distance_;
+    float still_distance_;
+    int still_frames_;
+    int max_missed_;
+    int next_id_;
+
+    vector<Track> tracks_;
+    vector<Rect> retired_;
+    vector<char> matched_;
+    unordered_map<long long, vector<int> > grid_;
+};
+
+#endif // __Tracker_h
@@ -0,0 +1,93 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       AllocationCounter.cxx
+ *
+ *   @brief      Handle counting Mat buffer allocations in builds with COUNT_ALLOCATIONS
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <atomic>
+#include <opencv2/opencv.hpp>
+
+#include "AllocationCounter.h"
+
+using namespace cv;
+
+// the count allocations on this thread are charged to, set by the innermost open AllocationScope
+static thread_local std::atomic<size_t>* current_count = nullptr;
+
+AllocationScope::AllocationScope() : own_count_(0), count_(&own_count_), previous_(current_count) {
+    current_count = count_;
+}
+
+AllocationScope::AllocationScope(std::atomic<size_t>* count)
+    : own_count_(0), count_(count ? count : &own_count_), previous_(current_count) {
+    current_count = count;
+}
+
+AllocationScope::~AllocationScope() {
+    current_count = previous_;
+}
+
+std::atomic<size_t>* AllocationScope::current() {
+    return current_count;
+}
+
+#ifdef COUNT_ALLOCATIONS
+
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 2)
+typedef AccessFlag AllocatorAccessFlag;
+#else
+typedef int AllocatorAccessFlag;
+#endif
+
+// counts new buffers, then hands everything to OpenCV's own allocator
+class CountingAllocator : public MatAllocator {
+public:
+    CountingAllocator() : std_allocator_(Mat::getStdAllocator()) {}
+
+    UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                       AllocatorAccessFlag flags, UMatUsageFlags usageFlags) const {
+        if (!data && current_count) {
+            ++*current_count;
+        }
+        return std_allocator_->allocate(dims, sizes, type, data, step, flags, usageFlags);
+    }
+
+    bool allocate(UMatData* data, AllocatorAccessFlag accessflags, UMatUsageFlags usageFlags) const {
+        return std_allocator_->allocate(data, accessflags, usageFlags);
+    }
+
+    void deallocate(UMatData* data) const {
+        std_allocator_->deallocate(data);
+    }
+
+private:
+    MatAllocator* std_allocator_;
+};
+
+void installAllocationCounter() {
+    static CountingAllocator allocator;
+    Mat::setDefaultAllocator(&allocator);
+}
+
+bool allocationCounting() {
+    return true;
+}
+
+#else
+
+void installAllocationCounter() {
+}
+
+bool allocationCounting() {
+    return false;
+}
+
+#endif
@@ -0,0 +1,100 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       BackgroundModel.cxx
+ *
+ *   @brief      Handle the static and adaptive backgrounds frames are compared against
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <stdexcept>
+
+#include "BackgroundModel.h"
+
+void BackgroundModel::initialise(const Mat& first_frame) {
+    if (first_frame.channels() == 1) {
+        medianBlur(first_frame, background_, 3);
+        return;
+    }
+
+    cvtColor(first_frame, background_, COLOR_BGR2GRAY); // take mean of first 3 or 5 frames?
+    medianBlur(background_, background_, 3);
+}
+
+void BackgroundModel::absorb(const Mat& gray_frame, const Rect& region) {
+    Rect clipped = region & Rect(0, 0, background_.cols, background_.rows);
+    gray_frame(clipped).copyTo(background_(clipped));
+}
+
+void StaticBackground::updateRows(const Mat&, const Range&) {
+}
+
+RunningAverageBackground::RunningAverageBackground(double learning_rate)
+    : learning_rate_(learning_rate) {
+    if (learning_rate_ < 0 || learning_rate_ > 1) {
+        throw runtime_error("The learning rate must be between 0 and 1");
+    }
+}
+
+void RunningAverageBackground::initialise(const Mat& first_frame) {
+    BackgroundModel::initialise(first_frame);
+
+    // allocated once here, every update works in place on this buffer
+    background_.convertTo(average_, CV_32F);
+}
+
+void RunningAverageBackground::updateRows(const Mat& gray_frame, const Range& rows) {
+    CV_Assert(gray_frame.type() == CV_8UC1 && gray_frame.size() == average_.size());
+
+    Mat src_rows = gray_frame.rowRange(rows);
+    Mat avg_rows = average_.rowRange(rows);
+    Mat bg_rows = background_.rowRange(rows);
+
+    Size size = src_rows.size();
+    if (src_rows.isContinuous() && avg_rows.isContinuous() && bg_rows.isContinuous()) {
+        size.width *= size.height;
+        size.height = 1;
+    }
+
+    float rate = (float)learning_rate_;
+
+    // average = (1 - rate) * average + rate * frame, rounded into the background in the same pass
+    for (int y = 0; y < size.height; ++y) {
+        const uchar* src = src_rows.ptr<uchar>(y);
+        float* avg = avg_rows.ptr<float>(y);
+        uchar* bg = bg_rows.ptr<uchar>(y);
+
+        for (int x = 0; x < size.width; ++x) {
+            avg[x] += rate * (src[x] - avg[x]);
+            bg[x] = saturate_cast<uchar>(avg[x]);
+        }
+    }
+}
+
+void RunningAverageBackground::absorb(const Mat& gray_frame, const Rect& region) {
+    BackgroundModel::absorb(gray_frame, region);
+
+    Rect clipped = region & Rect(0, 0, average_.cols, average_.rows);
+    gray_frame(clipped).convertTo(average_(clipped), CV_32F);
+}
+
+Ptr<BackgroundModel> createBackgroundModel(const string& name, double learning_rate) {
+    if (name == "static") {
+        return makePtr<StaticBackground>();
+    }
+    if (name == "average") {
+        return makePtr<RunningAverageBackground>(learning_rate);
+    }
+
+    string error_message;
+    error_message  = "Unknown background model \"";
+    error_message += name;
+    error_message += "\". Use static or average.";
+
+    throw error_message;
+}
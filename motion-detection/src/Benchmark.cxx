@@ -0,0 +1,188 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       Benchmark.cxx
+ *
+ *   @brief      Times the detection functions on synthetic frames of moving blobs over noise
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <iostream>
+#include <exception>
+#include <opencv2/opencv.hpp>
+
+#include "BackgroundModel.h"
+#include "Detection.h"
+#include "ChangeMap.h"
+#include "BenchmarkHarness.h"
+
+using namespace std;
+using namespace cv;
+
+static const int FRAMES = 4;
+static const int BLOBS = 24;
+
+/**
+ * A horizontal gradient with a little noise, the same on every run.
+ *
+ * @param size: The size of the frame.
+ * @param rng: The generator the noise is drawn from.
+ */
+static Mat syntheticBackground(Size size, RNG& rng) {
+    Mat background(size, CV_8UC3);
+
+    for (int y = 0; y < size.height; y++) {
+        uchar* row = background.ptr<uchar>(y);
+        for (int x = 0; x < size.width; x++) {
+            uchar value = (uchar)(40 + 160 * x / size.width);
+            row[3 * x] = value;
+            row[3 * x + 1] = value;
+            row[3 * x + 2] = value;
+        }
+    }
+
+    Mat noise(size, CV_8UC3);
+    rng.fill(noise, RNG::UNIFORM, 0, 12);
+    background += noise;
+
+    return background;
+}
+
+/**
+ * The background with fresh noise and blobs that move a little further every frame.
+ *
+ * @param background: The frame the blobs are drawn over.
+ * @param index: Which frame of the sequence this is.
+ * @param rng: The generator the noise is drawn from.
+ */
+static Mat syntheticFrame(const Mat& background, int index, RNG& rng) {
+    Mat frame = background.clone();
+
+    Mat noise(frame.size(), CV_8UC3);
+    rng.fill(noise, RNG::UNIFORM, 0, 12);
+    frame += noise;
+    frame -= Scalar::all(6);
+
+    // each blob gets its own generator so its path does not depend on the frame noise
+    int scale = max(1, frame.cols / 160);
+    for (int i = 0; i < BLOBS; i++) {
+        RNG blob_rng(1000 + i);
+        int x = blob_rng.uniform(0, frame.cols);
+        int y = blob_rng.uniform(0, frame.rows);
+        int dx = blob_rng.uniform(-4, 5) * scale;
+        int dy = blob_rng.uniform(-4, 5) * scale;
+        int radius = blob_rng.uniform(2, 8) * scale;
+
+        Point centre((x + dx * index + 10 * frame.cols) % frame.cols,
+                     (y + dy * index + 10 * frame.rows) % frame.rows);
+        circle(frame, centre, radius, Scalar(blob_rng.uniform(0, 256), 255, blob_rng.uniform(0, 256)), FILLED);
+    }
+
+    return frame;
+}
+
+int main(int argc, char** argv) {
+    try {
+        BenchmarkOptions options = parseBenchmarkOptions(argc, argv);
+        vector<BenchmarkSize> sizes = benchmarkSizes(options);
+        BenchmarkRunner runner(options);
+
+        for (size_t s = 0; s < sizes.size(); s++) {
+            const BenchmarkSize& size = sizes[s];
+
+            RNG rng(0x5eed);
+            Mat background_image = syntheticBackground(size.size, rng);
+            vector<Mat> frames;
+            for (int i = 0; i < FRAMES; i++) {
+                frames.push_back(syntheticFrame(background_image, i + 1, rng));
+            }
+
+            // the mask cleanBinaryImage is timed on, made outside the timed runs so -filter cannot skip it
+            Mat binary;
+            {
+                StaticBackground background;
+                background.initialise(background_image);
+
+                DetectionSettings settings;
+                DetectionContext context;
+                getForegroundMask(background, frames[0], settings, context);
+                context.binary.copyTo(binary);
+            }
+
+            const char* mode_names[2] = { "normalised", "fixed" };
+            ThresholdMode modes[2] = { THRESHOLD_NORMALISED, THRESHOLD_FIXED };
+
+            for (int m = 0; m < 2; m++) {
+                StaticBackground background;
+                background.initialise(background_image);
+
+                DetectionSettings settings;
+                settings.threshold_mode = modes[m];
+                DetectionContext context;
+                size_t next = 0;
+
+                runner.run(string("getForegroundMask/") + mode_names[m] + "/" + size.name, [&]() {
+                    getForegroundMask(background, frames[next++ % frames.size()], settings, context);
+                });
+            }
+
+            // the luma-only path that raw YUV input takes
+            {
+                vector<Mat> luma(frames.size());
+                for (size_t i = 0; i < frames.size(); i++) {
+                    cvtColor(frames[i], luma[i], COLOR_BGR2GRAY);
+                }
+
+                StaticBackground background;
+                background.initialise(background_image);
+
+                DetectionSettings settings;
+                DetectionContext context;
+                size_t next = 0;
+
+                runner.run("getForegroundMask/luma/" + size.name, [&]() {
+                    getForegroundMask(background, luma[next++ % luma.size()], settings, context);
+                });
+            }
+
+            // only the blocks around the moving blobs are processed
+            {
+                StaticBackground background;
+                background.initialise(background_image);
+
+                DetectionSettings settings;
+                settings.block_thresh = 12;
+                DetectionContext context;
+                size_t next = 0;
+
+                runner.run("getForegroundMask/blocks/" + size.name, [&]() {
+                    getForegroundMaskBlocks(background, frames[next++ % frames.size()], settings, context);
+                });
+            }
+
+            DetectionContext context;
+            Mat cleaned;
+            runner.run("cleanBinaryImage/" + size.name, [&]() {
+                cleanBinaryImage(binary, cleaned, context.close_element, context.open_element);
+            });
+        }
+
+        return runner.finish();
+    } catch (const exception& error) {
+        // Display an error message in the console
+        cerr << error.what() << endl;
+    } catch (const string& error) {
+        // Display an error message in the console
+        cerr << error << endl;
+    } catch (...) {
+        // Display an error message in the console
+        cerr << "Unnown error caught" << endl;
+    }
+
+    return 1;
+}
@@ -0,0 +1,190 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       Blobs.cxx
+ *
+ *   @brief      Handle finding connected regions of a mask from its runs instead of its pixels
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+
+#include "Blobs.h"
+#include "AllocationCounter.h"
+
+static int findRoot(vector<int>& parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+// sum of k^2 for k = 0..n
+static double sumOfSquares(double n) {
+    return n * (n + 1) * (2 * n + 1) / 6;
+}
+
+double Blob::orientation() const {
+    double cx = m10 / area;
+    double cy = m01 / area;
+    double mu20 = m20 / area - cx * cx;
+    double mu02 = m02 / area - cy * cy;
+    double mu11 = m11 / area - cx * cy;
+
+    return 0.5 * atan2(2 * mu11, mu20 - mu02);
+}
+
+void encodeRuns(const Mat& mask, const Range& rows, vector<MaskRun>& runs) {
+    CV_Assert(mask.type() == CV_8UC1);
+
+    int width = mask.cols;
+
+    for (int y = rows.start; y < rows.end; ++y) {
+        const uchar* pixels = mask.ptr<uchar>(y);
+        int x = 0;
+
+        while (x < width) {
+            // motion masks are mostly empty, so skip zeros eight at a time
+            for (; x + 8 <= width; x += 8) {
+                uint64_t chunk;
+                memcpy(&chunk, pixels + x, sizeof(chunk));
+                if (chunk) {
+                    break;
+                }
+            }
+            while (x < width && !pixels[x]) {
+                ++x;
+            }
+            if (x >= width) {
+                break;
+            }
+
+            MaskRun run;
+            run.row = y;
+            run.start = x;
+            while (x < width && pixels[x]) {
+                ++x;
+            }
+            run.end = x;
+
+            runs.push_back(run);
+        }
+    }
+}
+
+void BlobExtractor::extract(const Mat& mask, vector<Blob>& blobs, int tiles) {
+    int rows = mask.rows;
+    tiles = max(1, min(tiles, rows));
+
+    runs_.clear();
+
+    if (tiles > 1) {
+        tile_runs_.resize(tiles);
+
+        std::atomic<size_t>* allocations = AllocationScope::current();
+
+        parallel_for_(Range(0, tiles), [&](const Range& range) {
+            AllocationScope tile_allocations(allocations);
+
+            for (int t = range.start; t < range.end; ++t) {
+                tile_runs_[t].clear();
+                encodeRuns(mask, Range(rows * t / tiles, rows * (t + 1) / tiles), tile_runs_[t]);
+            }
+        });
+
+        for (int t = 0; t < tiles; ++t) {
+            runs_.insert(runs_.end(), tile_runs_[t].begin(), tile_runs_[t].end());
+        }
+    } else {
+        encodeRuns(mask, Range(0, rows), runs_);
+    }
+
+    int run_count = (int)runs_.size();
+
+    // row_start_[y] is the first run on row y
+    row_start_.assign(rows + 1, 0);
+    for (int i = 0; i < run_count; ++i) {
+        ++row_start_[runs_[i].row + 1];
+    }
+    for (int y = 0; y < rows; ++y) {
+        row_start_[y + 1] += row_start_[y];
+    }
+
+    parent_.resize(run_count);
+    for (int i = 0; i < run_count; ++i) {
+        parent_[i] = i;
+    }
+
+    // join runs that touch a run on the row above, diagonals included
+    for (int y = 1; y < rows; ++y) {
+        int i = row_start_[y - 1];
+        int j = row_start_[y];
+
+        while (i < row_start_[y] && j < row_start_[y + 1]) {
+            const MaskRun& above = runs_[i];
+            const MaskRun& below = runs_[j];
+
+            if (above.start <= below.end && below.start <= above.end) {
+                int root_above = findRoot(parent_, i);
+                int root_below = findRoot(parent_, j);
+
+                // keep the earliest run as the root, so blobs come out in raster order
+                if (root_above < root_below) {
+                    parent_[root_below] = root_above;
+                } else {
+                    parent_[root_above] = root_below;
+                }
+            }
+
+            if (above.end < below.end) {
+                ++i;
+            } else {
+                ++j;
+            }
+        }
+    }
+
+    blobs.clear();
+    blob_index_.assign(run_count, -1);
+
+    for (int i = 0; i < run_count; ++i) {
+        const MaskRun& run = runs_[i];
+        int root = findRoot(parent_, i);
+        Rect run_rect(run.start, run.row, run.end - run.start, 1);
+
+        if (blob_index_[root] < 0) {
+            blob_index_[root] = (int)blobs.size();
+
+            Blob blob;
+            blob.area = 0;
+            blob.bounds = run_rect;
+            blob.m10 = blob.m01 = blob.m20 = blob.m11 = blob.m02 = 0;
+            blobs.push_back(blob);
+        }
+
+        Blob& blob = blobs[blob_index_[root]];
+        double n = run.end - run.start;
+        double y = run.row;
+        double sum_x = (run.start + run.end - 1) * n / 2;
+
+        blob.area += run.end - run.start;
+        blob.bounds |= run_rect;
+        blob.m10 += sum_x;
+        blob.m01 += n * y;
+        blob.m20 += sumOfSquares(run.end - 1) - sumOfSquares(run.start - 1);
+        blob.m11 += y * sum_x;
+        blob.m02 += n * y * y;
+    }
+
+    for (size_t i = 0; i < blobs.size(); ++i) {
+        blobs[i].centroid = Point2f((float)(blobs[i].m10 / blobs[i].area), (float)(blobs[i].m01 / blobs[i].area));
+    }
+}
@@ -0,0 +1,175 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       ChangeMap.cxx
+ *
+ *   @brief      Handle finding the changed blocks of a frame and detecting motion only inside them
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <algorithm>
+
+#include "ChangeMap.h"
+#include "ForegroundKernels.h"
+#include "TiledDetection.h"
+#include "Stats.h"
+
+static Rect grow(const Rect& region, int halo, const Rect& bounds) {
+    return Rect(region.x - halo, region.y - halo, region.width + 2 * halo, region.height + 2 * halo) & bounds;
+}
+
+void activeRegions(const Mat& sums, Size frame_size, int mean_thresh, Mat& active, vector<Rect>& regions) {
+    active.create(sums.size(), CV_8UC1);
+
+    for (int r = 0; r < sums.rows; ++r) {
+        const int* row_sums = sums.ptr<int>(r);
+        uchar* row_active = active.ptr<uchar>(r);
+        int block_height = min(CHANGE_BLOCK, frame_size.height - r * CHANGE_BLOCK);
+
+        for (int c = 0; c < sums.cols; ++c) {
+            // edge blocks are compared by their real area
+            int block_width = min(CHANGE_BLOCK, frame_size.width - c * CHANGE_BLOCK);
+            row_active[c] = row_sums[c] > mean_thresh * block_width * block_height ? 255 : 0;
+        }
+    }
+
+    dilate(active, active, Mat());
+
+    // join the runs of active blocks on each row onto the rectangles they touch on the row above
+    regions.clear();
+    for (int r = 0; r < active.rows; ++r) {
+        const uchar* row_active = active.ptr<uchar>(r);
+        int c = 0;
+
+        while (c < active.cols) {
+            if (!row_active[c]) {
+                ++c;
+                continue;
+            }
+
+            int start = c;
+            while (c < active.cols && row_active[c]) {
+                ++c;
+            }
+
+            bool joined = false;
+            for (size_t i = 0; i < regions.size() && !joined; ++i) {
+                Rect& region = regions[i];
+                int bottom = region.y + region.height;
+
+                if ((bottom == r || bottom == r + 1) && start < region.x + region.width && c > region.x) {
+                    int right = max(region.x + region.width, c);
+                    region.x = min(region.x, start);
+                    region.width = right - region.x;
+                    region.height = r + 1 - region.y;
+                    joined = true;
+                }
+            }
+
+            if (!joined) {
+                regions.push_back(Rect(start, r, c - start, 1));
+            }
+        }
+    }
+
+    Rect frame_rect(0, 0, frame_size.width, frame_size.height);
+    for (size_t i = 0; i < regions.size(); ++i) {
+        Rect& region = regions[i];
+        region = Rect(region.x * CHANGE_BLOCK, region.y * CHANGE_BLOCK,
+                      region.width * CHANGE_BLOCK, region.height * CHANGE_BLOCK) & frame_rect;
+    }
+}
+
+const Mat& getForegroundMaskBlocks(BackgroundModel& background, const Mat& next_frame,
+                                   const DetectionSettings& settings, DetectionContext& context) {
+    const Mat& bg = background.background();
+    Size size = next_frame.size();
+    Rect frame_rect(0, 0, size.width, size.height);
+
+    {
+        ScopedTimer timer(STAGE_CHANGE_MAP);
+        blockDifference(next_frame, bg, context.gray, context.block_sums, CHANGE_BLOCK);
+        activeRegions(context.block_sums, size, settings.block_thresh, context.block_active, context.regions);
+    }
+
+    context.mask.create(size, CV_8UC1);
+    context.mask.setTo(Scalar::all(0));
+
+    if (!context.regions.empty()) {
+        // whole-frame buffers, so regions of any size are worked on in place without allocating
+        context.blurred.create(size, CV_8UC1);
+        context.binary.create(size, CV_8UC1);
+        context.difference.create(size, CV_8UC1);
+
+        int aThreshold = settings.fore_thresh;
+        int min_value = 255;
+        int max_value = 0;
+
+        // pass 1: blur and difference each region plus the halo the morphology needs
+        for (size_t i = 0; i < context.regions.size(); ++i) {
+            Rect diff_rect = grow(context.regions[i], CLEAN_HALO, frame_rect);
+            Rect blur_rect = grow(diff_rect, MEDIAN_HALO, frame_rect);
+            Mat difference_rect = context.difference(diff_rect);
+            Mat blurred_rect = context.blurred(blur_rect);
+
+            if (settings.threshold_mode == THRESHOLD_FIXED) {
+                Mat gray_rect;
+                Mat binary_rect = context.binary(blur_rect);
+                {
+                    ScopedTimer timer(STAGE_DIFFERENCE);
+                    fusedForegroundMask(context.gray(blur_rect), bg(blur_rect), gray_rect, binary_rect, aThreshold);
+                }
+                {
+                    ScopedTimer timer(STAGE_GRAY_BLUR);
+                    medianBlur(binary_rect, blurred_rect, 5);
+                }
+                context.blurred(diff_rect).copyTo(difference_rect);
+            } else {
+                {
+                    ScopedTimer timer(STAGE_GRAY_BLUR);
+                    medianBlur(context.gray(blur_rect), blurred_rect, 5);
+                }
+
+                ScopedTimer timer(STAGE_DIFFERENCE);
+                int region_min, region_max;
+                absDiffRange(context.blurred(diff_rect), bg(diff_rect), difference_rect, region_min, region_max);
+                min_value = min(min_value, region_min);
+                max_value = max(max_value, region_max);
+            }
+        }
+
+        // pass 2: threshold and clean, keeping only each region's own pixels
+        for (size_t i = 0; i < context.regions.size(); ++i) {
+            const Rect& region = context.regions[i];
+            Rect diff_rect = grow(region, CLEAN_HALO, frame_rect);
+            Rect core = region - diff_rect.tl();
+            Mat cleaned = context.blurred(diff_rect);
+
+            if (settings.threshold_mode == THRESHOLD_FIXED) {
+                ScopedTimer timer(STAGE_MORPHOLOGY);
+                cleanBinaryImage(context.difference(diff_rect), cleaned, context.close_element, context.open_element);
+            } else {
+                Mat binary_rect = context.binary(diff_rect);
+                {
+                    ScopedTimer timer(STAGE_DIFFERENCE);
+                    thresholdNormalised(context.difference(diff_rect), binary_rect, min_value, max_value, aThreshold);
+                }
+                ScopedTimer timer(STAGE_MORPHOLOGY);
+                cleanBinaryImage(binary_rect, cleaned, context.close_element, context.open_element);
+            }
+
+            cleaned(core).copyTo(context.mask(region));
+        }
+    }
+
+    // only learn from the frame once every region has been compared
+    background.update(context.gray);
+    context.compared = context.gray;
+
+    return context.mask;
+}
@@ -0,0 +1,163 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       Detection.cxx
+ *
+ *   @brief      Handle the per-frame logic for detecting motion against a background
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <iostream>
+
+#include "Detection.h"
+#include "ForegroundKernels.h"
+#include "TiledDetection.h"
+#include "ChangeMap.h"
+#include "AllocationCounter.h"
+#include "Stats.h"
+
+DetectionContext::DetectionContext(int elementSize)
+    : frames(0), frame_allocations(0), allocation_warned(false) {
+    open_element = getStructuringElement(MORPH_ELLIPSE, Size(elementSize, elementSize));
+    close_element = open_element + 5;
+}
+
+Mat cleanBinaryImage(const Mat& aBinaryImage, int elementSize)
+{
+    Mat output;
+
+    Mat element = getStructuringElement(MORPH_ELLIPSE,
+                        Size(elementSize, elementSize));
+
+    cleanBinaryImage(aBinaryImage, output, element + 5, element);
+
+    return output;
+}
+
+void cleanBinaryImage(const Mat& aBinaryImage, Mat& output, const Mat& close_element, const Mat& open_element)
+{
+    morphologyEx(aBinaryImage, output, MORPH_CLOSE, close_element);
+    morphologyEx(output, output, MORPH_OPEN, open_element);
+}
+
+Mat getForegroundMask(BackgroundModel& background, const Mat& next_frame, int aThreshold, ThresholdMode mode) {
+    DetectionSettings settings;
+    settings.fore_thresh = aThreshold;
+    settings.threshold_mode = mode;
+
+    DetectionContext context;
+
+    return getForegroundMask(background, next_frame, settings, context);
+}
+
+const Mat& getForegroundMask(BackgroundModel& background, const Mat& next_frame,
+                             const DetectionSettings& settings, DetectionContext& context) {
+    if (settings.threshold_mode == THRESHOLD_FIXED) {
+        // gray, difference and threshold in one pass, then blur the mask instead of the frame
+        {
+            ScopedTimer timer(STAGE_DIFFERENCE);
+            fusedForegroundMask(next_frame, background.background(), context.gray, context.difference, settings.fore_thresh);
+        }
+        {
+            ScopedTimer timer(STAGE_GRAY_BLUR);
+            medianBlur(context.difference, context.binary, 5);
+        }
+
+        // only learn from the frame once it has been compared
+        background.update(context.gray);
+        context.compared = context.gray;
+    } else {
+        {
+            ScopedTimer timer(STAGE_GRAY_BLUR);
+
+            // a luma plane is blurred straight from the input
+            if (next_frame.channels() == 1) {
+                medianBlur(next_frame, context.blurred, 5);
+            } else {
+                cvtColor(next_frame, context.gray, COLOR_BGR2GRAY);
+                medianBlur(context.gray, context.blurred, 5);
+            }
+        }
+
+        ScopedTimer timer(STAGE_DIFFERENCE);
+        int min_value, max_value;
+        absDiffRange(context.blurred, background.background(), context.difference, min_value, max_value);
+        thresholdNormalised(context.difference, context.binary, min_value, max_value, settings.fore_thresh);
+
+        background.update(context.blurred);
+        context.compared = context.blurred;
+    }
+
+    ScopedTimer timer(STAGE_MORPHOLOGY);
+    cleanBinaryImage(context.binary, context.mask, context.close_element, context.open_element);
+
+    return context.mask;
+}
+
+void detectMotion(BackgroundModel& background, const Mat& frame, const DetectionSettings& settings,
+                  DetectionContext& context, Mat& annotated) {
+    ScopedTimer frame_timer(STAGE_FRAME);
+
+    // only this frame's work is counted, not whatever other threads allocate meanwhile
+    AllocationScope allocations;
+
+    if (settings.block_thresh > 0) {
+        getForegroundMaskBlocks(background, frame, settings, context);
+    } else if (settings.tiles > 1) {
+        getForegroundMaskTiled(background, frame, settings, context);
+    } else {
+        getForegroundMask(background, frame, settings, context);
+    }
+
+    {
+        ScopedTimer timer(STAGE_BLOBS);
+        context.blob_extractor.extract(context.mask, context.blobs, settings.tiles);
+    }
+
+    annotated.create(frame.size(), frame.type());
+    annotated.setTo(Scalar::all(0));
+    frame.copyTo(annotated, context.mask);
+
+    // luma only frames are annotated in white
+    Scalar box_colour = frame.channels() == 1 ? Scalar::all(255) : Scalar(0,255,0);
+    Scalar track_colour = frame.channels() == 1 ? Scalar::all(255) : Scalar(0,0,255);
+
+    for (size_t i = 0; i < context.blobs.size(); i++) {
+        if (context.blobs[i].area > settings.area_thresh) {
+            rectangle(annotated, context.blobs[i].bounds, box_colour);
+        }
+    }
+
+    if (settings.track) {
+        context.tracker.update(context.blobs, settings.area_thresh);
+
+        // anything that has stood still long enough is part of the scene now
+        const vector<Rect>& retired = context.tracker.retired();
+        for (size_t i = 0; i < retired.size(); i++) {
+            background.absorb(context.compared, retired[i]);
+        }
+
+        const vector<Track>& tracks = context.tracker.tracks();
+        for (size_t i = 0; i < tracks.size(); i++) {
+            Point2f ahead = tracks[i].position + 5 * tracks[i].velocity;
+            arrowedLine(annotated, tracks[i].position, ahead, track_colour);
+        }
+    }
+
+    context.frame_allocations = allocations.count();
+    ++context.frames;
+
+#ifdef COUNT_ALLOCATIONS
+    // every buffer has reached its final size after the first couple of frames
+    if (context.frames > 2 && context.frame_allocations > 0 && !context.allocation_warned) {
+        cerr << "warning: frame " << context.frames << " allocated " << context.frame_allocations
+             << " Mat buffers after warm-up" << endl;
+        context.allocation_warned = true;
+    }
+#endif
+}
@@ -0,0 +1,157 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       DisplayMode.cxx
+ *
+ *   @brief      Handle the interactive loop, keeping HighGUI off the detection thread
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+
+#include "DisplayMode.h"
+#include "LatestMailbox.h"
+#include "Stats.h"
+
+struct DisplayFrame {
+    Mat frame;
+    Mat annotated;
+    Mat background;
+};
+
+// written by the trackbars on the main thread, read by the detector once per frame
+struct LiveThresholds {
+    LiveThresholds(const DetectionSettings& settings) : fore_thresh(settings.fore_thresh),
+                                                        area_thresh(settings.area_thresh) {}
+
+    atomic<int> fore_thresh;
+    atomic<int> area_thresh;
+};
+
+static void storeThreshold(int pos, void* userdata) {
+    static_cast<atomic<int>*>(userdata)->store(pos, memory_order_relaxed);
+}
+
+void runDisplay(VideoCapture& input, const string& output_filename, BackgroundModel& background,
+                const DetectionSettings& settings, bool display) {
+    Mat first_frame;
+    input >> first_frame;
+
+    if (first_frame.empty()) {
+        throw runtime_error("Video finished or OpenCV cannot read the video file");
+    }
+
+    background.initialise(first_frame);
+
+    // Save video
+    int fps = input.get(CAP_PROP_FPS);
+    VideoWriter video_output(output_filename, VideoWriter::fourcc('M', 'P', 'E', 'G'), fps > 0 ? fps : 30,
+                             Size(first_frame.cols, first_frame.rows));
+
+    LatestMailbox<DisplayFrame> mailbox;
+    LiveThresholds thresholds(settings);
+    atomic<bool> stopping(false);
+    exception_ptr detect_error;
+
+    auto process = [&]() {
+        try {
+            DisplayFrame slot;
+            DetectionContext context;
+            DetectionSettings current = settings;
+
+            while (!stopping) {
+                // reads into the buffers handed back by the previous put, so the loop does not allocate
+                {
+                    ScopedTimer timer(STAGE_DECODE);
+                    input >> slot.frame;
+                }
+
+                if (slot.frame.empty()) {
+                    break;
+                }
+
+                current.fore_thresh = thresholds.fore_thresh.load(memory_order_relaxed);
+                current.area_thresh = thresholds.area_thresh.load(memory_order_relaxed);
+
+                detectMotion(background, slot.frame, current, context, slot.annotated);
+
+                if (video_output.isOpened()) {
+                    ScopedTimer timer(STAGE_ENCODE);
+                    video_output.write(slot.annotated);
+                }
+
+                if (display) {
+                    background.background().copyTo(slot.background);
+                    mailbox.put(slot);
+                }
+            }
+        } catch (...) {
+            detect_error = current_exception();
+        }
+        mailbox.close();
+    };
+
+    if (!display) {
+        process();
+    } else {
+        namedWindow("Input Video");
+        namedWindow("Foreground");
+        namedWindow("Background");
+
+        // made once; the callbacks only store the new position for the detector to pick up
+        createTrackbar("Contour Threshold", "Foreground", NULL, 528, storeThreshold, &thresholds.area_thresh);
+        createTrackbar("Foreground Threshold", "Foreground", NULL, 255, storeThreshold, &thresholds.fore_thresh);
+        setTrackbarPos("Contour Threshold", "Foreground", settings.area_thresh);
+        setTrackbarPos("Foreground Threshold", "Foreground", settings.fore_thresh);
+
+        imshow("Background", background.background());
+
+        thread worker(process);
+        exception_ptr display_error;
+
+        try {
+            DisplayFrame shown;
+            int key = -1;
+
+            while (key != 27 && key != 113) { // esc or q
+                // checked first, so the last frame is still shown once the worker has finished
+                bool finished = mailbox.isClosed();
+
+                if (mailbox.tryTake(shown)) {
+                    ScopedTimer timer(STAGE_DISPLAY);
+                    imshow("Input Video", shown.frame);
+                    imshow("Foreground", shown.annotated);
+                    imshow("Background", shown.background);
+                } else if (finished) {
+                    break;
+                }
+
+                key = waitKey(1);
+            }
+        } catch (...) {
+            display_error = current_exception();
+        }
+
+        stopping = true;
+        worker.join();
+        destroyAllWindows();
+
+        if (display_error) {
+            rethrow_exception(display_error);
+        }
+    }
+
+    video_output.release();
+
+    if (detect_error) {
+        rethrow_exception(detect_error);
+    }
+}
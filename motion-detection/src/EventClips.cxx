@@ -0,0 +1,144 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       EventClips.cxx
+ *
+ *   @brief      Handle writing only the parts of a video with motion in them
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include "EventClips.h"
+#include "MotionMetadata.h"
+#include "Stats.h"
+
+EventClipWriter::EventClipWriter(const string& output_directory, double fps, Size frame_size,
+                                 int pre_roll, int post_roll)
+    : output_directory_(output_directory), fps_(fps), frame_size_(frame_size), post_roll_(post_roll),
+      post_left_(0), ring_(max(pre_roll, 0)), ring_head_(0), ring_count_(0), clips_(0), frames_written_(0) {
+}
+
+void EventClipWriter::write(Mat& frame, size_t index, bool motion) {
+    if (writer_.isOpened() && !motion && post_left_ == 0) {
+        writer_.release();
+    }
+
+    if (motion || writer_.isOpened()) {
+        ScopedTimer timer(STAGE_ENCODE);
+
+        if (!writer_.isOpened()) {
+            ostringstream filename;
+            filename << output_directory_ << "/clip" << setw(8) << setfill('0') << index - ring_count_ << ".avi";
+
+            writer_.open(filename.str(), VideoWriter::fourcc('M', 'P', 'E', 'G'), fps_, frame_size_);
+
+            if (!writer_.isOpened()) {
+                string error_message;
+                error_message  = "Could not open the output video \"";
+                error_message += filename.str();
+                error_message += "\".";
+
+                throw error_message;
+            }
+            ++clips_;
+
+            // the pre-roll, oldest first
+            for (size_t i = 0; i < ring_count_; i++) {
+                writer_.write(ring_[(ring_head_ + i) % ring_.size()]);
+            }
+            frames_written_ += ring_count_;
+            ring_head_ = 0;
+            ring_count_ = 0;
+        }
+
+        writer_.write(frame);
+        ++frames_written_;
+        post_left_ = motion ? post_roll_ : post_left_ - 1;
+
+        return;
+    }
+
+    if (ring_.empty()) {
+        return;
+    }
+
+    // overwrite the oldest frame once the ring is full
+    size_t slot;
+    if (ring_count_ == ring_.size()) {
+        slot = ring_head_;
+        ring_head_ = (ring_head_ + 1) % ring_.size();
+    } else {
+        slot = (ring_head_ + ring_count_) % ring_.size();
+        ++ring_count_;
+    }
+
+    swap(ring_[slot], frame);
+}
+
+void EventClipWriter::finish() {
+    writer_.release();
+}
+
+void runClips(VideoCapture& input, const string& output_directory, BackgroundModel& background,
+              const DetectionSettings& settings, int pre_roll, int post_roll) {
+    Mat frame;
+    input >> frame;
+
+    if (frame.empty()) {
+        throw runtime_error("Video finished or OpenCV cannot read the video file");
+    }
+
+    background.initialise(frame);
+
+    double fps = input.get(CAP_PROP_FPS);
+    if (fps <= 0) {
+        fps = 30;
+    }
+
+    Size frame_size(frame.cols, frame.rows);
+    EventClipWriter clips(output_directory, fps, frame_size, pre_roll, post_roll);
+    MetadataWriter metadata(output_directory + "/metadata.bin", frame_size, fps);
+
+    DetectionContext context;
+    Mat annotated;
+    size_t index = 0;
+
+    while (true) {
+        {
+            ScopedTimer timer(STAGE_DECODE);
+            input >> frame;
+        }
+
+        if (frame.empty()) {
+            break;
+        }
+        ++index;
+
+        double timestamp = input.get(CAP_PROP_POS_MSEC);
+        if (timestamp <= 0) {
+            timestamp = index * 1000 / fps;
+        }
+
+        detectMotion(background, frame, settings, context, annotated);
+
+        bool motion = metadata.write(index, timestamp, context.blobs, settings.area_thresh);
+        clips.write(frame, index, motion);
+    }
+
+    clips.finish();
+    metadata.finish();
+
+    cout << index << " frames processed, " << clips.framesWritten() << " written in "
+         << clips.clips() << " clips" << endl;
+}
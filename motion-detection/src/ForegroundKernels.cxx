@@ -0,0 +1,269 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       ForegroundKernels.cxx
+ *
+ *   @brief      Handle the 8-bit foreground kernels, vectorised with OpenCV's universal intrinsics
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <algorithm>
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "ForegroundKernels.h"
+
+// fixed-point BGR -> gray weights, the same ones cvtColor uses for 8-bit images
+static const int GRAY_SHIFT = 14;
+static const int GRAY_B = 1868;
+static const int GRAY_G = 9617;
+static const int GRAY_R = 4899;
+
+static inline uchar grayPixel(const uchar* bgr) {
+    return (uchar)((bgr[0] * GRAY_B + bgr[1] * GRAY_G + bgr[2] * GRAY_R + (1 << (GRAY_SHIFT - 1))) >> GRAY_SHIFT);
+}
+
+#if CV_SIMD128
+static inline v_uint16x8 grayVector(const v_uint16x8& b, const v_uint16x8& g, const v_uint16x8& r) {
+    v_uint32x4 b0, b1, g0, g1, r0, r1;
+    v_mul_expand(b, v_setall_u16(GRAY_B), b0, b1);
+    v_mul_expand(g, v_setall_u16(GRAY_G), g0, g1);
+    v_mul_expand(r, v_setall_u16(GRAY_R), r0, r1);
+
+    v_uint32x4 half = v_setall_u32(1 << (GRAY_SHIFT - 1));
+    v_uint32x4 lo = v_shr<GRAY_SHIFT>(b0 + g0 + r0 + half);
+    v_uint32x4 hi = v_shr<GRAY_SHIFT>(b1 + g1 + r1 + half);
+
+    return v_pack(lo, hi);
+}
+#endif
+
+// the luma plane already is the gray frame, so only the difference and threshold are left
+static void lumaForegroundMask(const Mat& luma, const Mat& background, Mat& mask, int aThreshold) {
+    mask.create(luma.size(), CV_8UC1);
+
+    Size size = luma.size();
+    if (luma.isContinuous() && background.isContinuous() && mask.isContinuous()) {
+        size.width *= size.height;
+        size.height = 1;
+    }
+
+    uchar thresh = saturate_cast<uchar>(aThreshold);
+
+    for (int y = 0; y < size.height; ++y) {
+        const uchar* src = luma.ptr<uchar>(y);
+        const uchar* bg = background.ptr<uchar>(y);
+        uchar* dst_mask = mask.ptr<uchar>(y);
+        int x = 0;
+
+#if CV_SIMD128
+        v_uint8x16 v_thresh = v_setall_u8(thresh);
+        for (; x <= size.width - 16; x += 16) {
+            v_store(dst_mask + x, v_absdiff(v_load(src + x), v_load(bg + x)) > v_thresh);
+        }
+#endif
+
+        for (; x < size.width; ++x) {
+            dst_mask[x] = abs(src[x] - bg[x]) > thresh ? 255 : 0;
+        }
+    }
+}
+
+void fusedForegroundMask(const Mat& frame, const Mat& background, Mat& gray, Mat& mask, int aThreshold) {
+    if (frame.type() == CV_8UC1) {
+        CV_Assert(background.type() == CV_8UC1 && frame.size() == background.size());
+
+        gray = frame;
+        lumaForegroundMask(frame, background, mask, aThreshold);
+
+        return;
+    }
+
+    CV_Assert(frame.type() == CV_8UC3 && background.type() == CV_8UC1 && frame.size() == background.size());
+
+    gray.create(frame.size(), CV_8UC1);
+    mask.create(frame.size(), CV_8UC1);
+
+    Size size = frame.size();
+    if (frame.isContinuous() && background.isContinuous() && gray.isContinuous() && mask.isContinuous()) {
+        size.width *= size.height;
+        size.height = 1;
+    }
+
+    uchar thresh = saturate_cast<uchar>(aThreshold);
+
+    for (int y = 0; y < size.height; ++y) {
+        const uchar* src = frame.ptr<uchar>(y);
+        const uchar* bg = background.ptr<uchar>(y);
+        uchar* dst_gray = gray.ptr<uchar>(y);
+        uchar* dst_mask = mask.ptr<uchar>(y);
+        int x = 0;
+
+#if CV_SIMD128
+        v_uint8x16 v_thresh = v_setall_u8(thresh);
+        for (; x <= size.width - 16; x += 16) {
+            v_uint8x16 b, g, r;
+            v_load_deinterleave(src + x * 3, b, g, r);
+
+            v_uint16x8 b0, b1, g0, g1, r0, r1;
+            v_expand(b, b0, b1);
+            v_expand(g, g0, g1);
+            v_expand(r, r0, r1);
+
+            v_uint8x16 v_gray = v_pack(grayVector(b0, g0, r0), grayVector(b1, g1, r1));
+            v_uint8x16 v_diff = v_absdiff(v_gray, v_load(bg + x));
+
+            v_store(dst_gray + x, v_gray);
+            v_store(dst_mask + x, v_diff > v_thresh);
+        }
+#endif
+
+        for (; x < size.width; ++x) {
+            uchar value = grayPixel(src + x * 3);
+            dst_gray[x] = value;
+            dst_mask[x] = abs(value - bg[x]) > thresh ? 255 : 0;
+        }
+    }
+}
+
+// one row of BGR to gray, the same conversion fusedForegroundMask does
+static void grayRow(const uchar* src, uchar* dst, int width) {
+    int x = 0;
+
+#if CV_SIMD128
+    for (; x <= width - 16; x += 16) {
+        v_uint8x16 b, g, r;
+        v_load_deinterleave(src + x * 3, b, g, r);
+
+        v_uint16x8 b0, b1, g0, g1, r0, r1;
+        v_expand(b, b0, b1);
+        v_expand(g, g0, g1);
+        v_expand(r, r0, r1);
+
+        v_store(dst + x, v_pack(grayVector(b0, g0, r0), grayVector(b1, g1, r1)));
+    }
+#endif
+
+    for (; x < width; ++x) {
+        dst[x] = grayPixel(src + x * 3);
+    }
+}
+
+void blockDifference(const Mat& frame, const Mat& background, Mat& gray, Mat& sums, int block) {
+    CV_Assert((frame.type() == CV_8UC3 || frame.type() == CV_8UC1) && background.type() == CV_8UC1 &&
+              frame.size() == background.size() && block > 0);
+
+    if (frame.type() == CV_8UC1) {
+        gray = frame;
+    } else {
+        gray.create(frame.size(), CV_8UC1);
+    }
+
+    int width = frame.cols;
+    int block_cols = (width + block - 1) / block;
+    sums.create((frame.rows + block - 1) / block, block_cols, CV_32SC1);
+    sums.setTo(Scalar::all(0));
+
+    for (int y = 0; y < frame.rows; ++y) {
+        const uchar* src = gray.ptr<uchar>(y);
+        const uchar* bg = background.ptr<uchar>(y);
+        int* row_sums = sums.ptr<int>(y / block);
+
+        // the row is summed straight after it is converted, while it is still in cache
+        if (frame.type() == CV_8UC3) {
+            grayRow(frame.ptr<uchar>(y), gray.ptr<uchar>(y), width);
+        }
+
+        for (int b = 0; b < block_cols; ++b) {
+            int x = b * block;
+            int end = min(width, x + block);
+            unsigned sum = 0;
+
+#if CV_SIMD128
+            for (; x <= end - 16; x += 16) {
+                sum += v_reduce_sad(v_load(src + x), v_load(bg + x));
+            }
+#endif
+
+            for (; x < end; ++x) {
+                sum += abs(src[x] - bg[x]);
+            }
+
+            row_sums[b] += sum;
+        }
+    }
+}
+
+void absDiffRange(const Mat& gray, const Mat& background, Mat& difference, int& min_value, int& max_value) {
+    CV_Assert(gray.type() == CV_8UC1 && background.type() == CV_8UC1 && gray.size() == background.size());
+
+    difference.create(gray.size(), CV_8UC1);
+
+    Size size = gray.size();
+    if (gray.isContinuous() && background.isContinuous() && difference.isContinuous()) {
+        size.width *= size.height;
+        size.height = 1;
+    }
+
+    uchar lo = 255;
+    uchar hi = 0;
+
+#if CV_SIMD128
+    v_uint8x16 v_lo = v_setall_u8(255);
+    v_uint8x16 v_hi = v_setall_u8(0);
+#endif
+
+    for (int y = 0; y < size.height; ++y) {
+        const uchar* src = gray.ptr<uchar>(y);
+        const uchar* bg = background.ptr<uchar>(y);
+        uchar* dst = difference.ptr<uchar>(y);
+        int x = 0;
+
+#if CV_SIMD128
+        for (; x <= size.width - 16; x += 16) {
+            v_uint8x16 v_diff = v_absdiff(v_load(src + x), v_load(bg + x));
+            v_lo = v_min(v_lo, v_diff);
+            v_hi = v_max(v_hi, v_diff);
+            v_store(dst + x, v_diff);
+        }
+#endif
+
+        for (; x < size.width; ++x) {
+            uchar value = (uchar)abs(src[x] - bg[x]);
+            lo = std::min(lo, value);
+            hi = std::max(hi, value);
+            dst[x] = value;
+        }
+    }
+
+#if CV_SIMD128
+    uchar lanes_lo[16];
+    uchar lanes_hi[16];
+    v_store(lanes_lo, v_lo);
+    v_store(lanes_hi, v_hi);
+    for (int i = 0; i < 16; ++i) {
+        lo = std::min(lo, lanes_lo[i]);
+        hi = std::max(hi, lanes_hi[i]);
+    }
+#endif
+
+    min_value = lo;
+    max_value = hi;
+}
+
+void thresholdNormalised(const Mat& difference, Mat& mask, int min_value, int max_value, int aThreshold) {
+    // mirror normalize(NORM_MINMAX, 0, 255) followed by threshold(THRESH_BINARY)
+    float scale = max_value > min_value ? 255.f / (max_value - min_value) : 0.f;
+    float shift = -min_value * scale;
+
+    uchar table[256];
+    for (int i = 0; i < 256; ++i) {
+        table[i] = saturate_cast<uchar>(i * scale + shift) > aThreshold ? 255 : 0;
+    }
+
+    LUT(difference, Mat(1, 256, CV_8UC1, table), mask);
+}
@@ -0,0 +1,155 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       LiveMode.cxx
+ *
+ *   @brief      Handle live feeds, dropping frames rather than falling behind
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+#include "LiveMode.h"
+#include "LatestMailbox.h"
+#include "Stats.h"
+
+struct LiveFrame {
+    LiveFrame() : captured(0), index(0) {}
+
+    Mat frame;
+    int64 captured;     // tick count when the frame was read
+    size_t index;
+};
+
+void runLive(VideoCapture& input, const string& output_filename, BackgroundModel& background,
+             const DetectionSettings& settings, double budget_ms, bool pace) {
+    Mat first_frame;
+    input >> first_frame;
+
+    if (first_frame.empty()) {
+        throw runtime_error("Video finished or OpenCV cannot read the video file");
+    }
+
+    background.initialise(first_frame);
+
+    double fps = input.get(CAP_PROP_FPS);
+    VideoWriter video_output;
+
+    if (!output_filename.empty()) {
+        video_output.open(output_filename, VideoWriter::fourcc('M', 'P', 'E', 'G'), fps > 0 ? fps : 30,
+                          Size(first_frame.cols, first_frame.rows));
+
+        if (!video_output.isOpened()) {
+            string error_message;
+            error_message  = "Could not open the output video \"";
+            error_message += output_filename;
+            error_message += "\".";
+
+            throw error_message;
+        }
+    }
+
+    double ticks_per_ms = getTickFrequency() / 1000;
+    LatestMailbox<LiveFrame> mailbox;
+    atomic<bool> stopping(false);
+    exception_ptr capture_error;
+
+    thread capture([&]() {
+        try {
+            LiveFrame slot;
+            size_t index = 0;
+            chrono::steady_clock::time_point next = chrono::steady_clock::now();
+            chrono::microseconds period(pace && fps > 0 ? (long long)(1e6 / fps) : 0);
+
+            while (!stopping) {
+                if (period.count() > 0) {
+                    this_thread::sleep_until(next);
+                    next += period;
+                }
+
+                // reads into the buffer handed back by the previous put, so capture does not allocate
+                {
+                    ScopedTimer timer(STAGE_DECODE);
+                    input >> slot.frame;
+                }
+
+                if (slot.frame.empty()) {
+                    break;
+                }
+
+                slot.captured = getTickCount();
+                slot.index = ++index;
+                mailbox.put(slot);
+            }
+        } catch (...) {
+            capture_error = current_exception();
+        }
+        mailbox.close();
+    });
+
+    size_t processed = 0;
+    size_t stale = 0;
+    double total_latency = 0;
+    double worst_latency = 0;
+    exception_ptr detect_error;
+
+    try {
+        LiveFrame current;
+        DetectionContext context;
+        Mat annotated;
+
+        while (mailbox.take(current)) {
+            double age = (getTickCount() - current.captured) / ticks_per_ms;
+
+            if (age > budget_ms) {
+                ++stale;
+                continue;
+            }
+
+            detectMotion(background, current.frame, settings, context, annotated);
+
+            double latency = (getTickCount() - current.captured) / ticks_per_ms;
+            total_latency += latency;
+            worst_latency = max(worst_latency, latency);
+            ++processed;
+
+            cout << "frame " << current.index << ": " << latency << " ms, "
+                 << context.blobs.size() << " regions" << endl;
+
+            if (video_output.isOpened()) {
+                ScopedTimer timer(STAGE_ENCODE);
+                video_output.write(annotated);
+            }
+        }
+    } catch (...) {
+        detect_error = current_exception();
+    }
+
+    stopping = true;
+    capture.join();
+    video_output.release();
+
+    if (capture_error) {
+        rethrow_exception(capture_error);
+    }
+    if (detect_error) {
+        rethrow_exception(detect_error);
+    }
+
+    cout << processed << " frames processed, " << mailbox.overwritten() << " replaced before processing, "
+         << stale << " over the " << budget_ms << " ms budget" << endl;
+    if (processed) {
+        cout << "latency: " << total_latency / processed << " ms mean, " << worst_latency << " ms worst" << endl;
+    }
+}
@@ -11,110 +11,223 @@
  *
  *   @todo       Camera pose estimation - for non-static shots?
  *               Auto background detection with createBackgroundSubtractorMOG2()
- *               OR
- *               Track location of contours: if no movement; remove
- *               Add moments for direction estimation
+ *               Use Blob::orientation for direction estimation
  *
  ********************************************************************************
  */
 
 #include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
 #include <exception>
 #include <stdexcept>
 #include <opencv2/opencv.hpp>
 
+#include "BackgroundModel.h"
+#include "Detection.h"
+#include "AllocationCounter.h"
+#include "Pipeline.h"
+#include "MultiStream.h"
+#include "LiveMode.h"
+#include "DisplayMode.h"
+#include "SegmentMode.h"
+#include "EventClips.h"
+#include "RawInput.h"
+#include "Stats.h"
+
 using namespace std;
 using namespace cv;
 
-Mat cleanBinaryImage(const Mat& aBinaryImage, int elementSize = 5)
-{
-    Mat output;
-
-    Mat element = getStructuringElement(MORPH_ELLIPSE,
-                        Size(elementSize, elementSize));
-
-    morphologyEx(aBinaryImage, output, MORPH_CLOSE, element + 5);
-    morphologyEx(output, output, MORPH_OPEN, element);
-
-    return output;
-}
-
-Mat getForegroundMask(const Mat& background, const Mat& next_frame, int aThreshold = 128) {
-    Mat current_frame;
-    cvtColor(next_frame, current_frame, COLOR_BGR2GRAY);
-    
-    medianBlur(current_frame, current_frame, 5);
+static string usageMessage(const string& exec_path) {
+    string error_message;
+    error_message  = "usage: ";
+    error_message += exec_path;
+    error_message += " [-display] <input_video/webcam> [-display]";
+    error_message += " <output_video> [-display]";
+    error_message += "\n       ";
+    error_message += exec_path;
+    error_message += " -pipeline <input_video/webcam> <output_video>";
+    error_message += "\n       ";
+    error_message += exec_path;
+    error_message += " -streams [-workers <n>] <output_dir> <input_video/device/manifest.txt> ...";
+    error_message += "\n       ";
+    error_message += exec_path;
+    error_message += " -live <budget_ms> <input_video/webcam> [output_video]";
+    error_message += "\n       ";
+    error_message += exec_path;
+    error_message += " -clips <pre_roll> <post_roll> <input_video/webcam> <output_dir>";
+    error_message += "\n       ";
+    error_message += exec_path;
+    error_message += " -raw <bgr/y8/nv12/i420> <width>x<height> [-fps <n>] <-/pipe/shm:name> [output_video]";
+    error_message += "\n       ";
+    error_message += exec_path;
+    error_message += " -segments <n> [-overlap <frames>] <input_video> <output_dir>";
+    error_message += "\n Every form accepts -background <static/average> [-rate <learning_rate>] [-fixed] [-tiles <n>] [-blocks <mean_difference>] [-track]";
+    error_message += "\n  and -stats <file.json/file.csv> [-stats-every <seconds>]";
+    error_message += "\n Ensure your -display flag is in the correct location.";
+    error_message += "\n -pipeline, -streams, -live, -clips, -raw and -segments run without a GUI and cannot be combined with -display.";
+    error_message += "\n <x/y> : both x and y are interchangable";
+    error_message += "\n [x] : x is singular and optional";
     
-    current_frame.convertTo(current_frame, CV_32F);
-    
-    Mat foreground;
-    foreground = background - current_frame;
-    foreground = abs(foreground);
-    
-    normalize(foreground, foreground, 0, 255, NORM_MINMAX, CV_8UC1);
-    
-    Mat mask;
-    threshold(foreground, mask, aThreshold, 255, THRESH_BINARY);
-    
-    mask = cleanBinaryImage(mask);
-    
-    return mask;
+    return error_message;
 }
 
 int main (int argc, char** argv) {
+    installAllocationCounter();
+    
     try {
         string filename_1;
         string filename_2;
         VideoCapture video_1;
-        VideoWriter video_output;
         bool display_vid_1 = false;
-        int key = -1;
+        bool pipeline = false;
+        bool streams = false;
+        size_t workers = 0;
+        double live_budget = -1;
+        int pre_roll = -1;
+        int post_roll = -1;
+        DetectionSettings settings;
+        string background_model = "static";
+        double learning_rate = 0.02;
+        string stats_filename;
+        double stats_interval = 0;
+        string raw_format;
+        Size raw_size;
+        double raw_fps = 30;
+        int segments = -1;
+        int overlap = 50;
         
         // ======= POSSIBLE ARGUMENT COMBOS ========
         // MotionDetection invideo outvideo
         // MotionDetection -display invideo outvideo
         // MotionDetection invideo -display outvideo
         // MotionDetection invideo outvideo -display
+        // MotionDetection -pipeline invideo outvideo
+        // MotionDetection -streams [-workers <n>] outdir invideo/device/manifest.txt ...
+        // MotionDetection -live budget_ms invideo [outvideo]
+        // MotionDetection -clips pre_roll post_roll invideo outdir
+        // MotionDetection -raw format WxH [-fps n] -/pipe/shm:name [outvideo]
+        // MotionDetection -segments n [-overlap frames] invideo outdir
+        // any of the above with -background <static/average> [-rate <learning_rate>] [-fixed] [-tiles <n>] [-blocks <mean_difference>] [-track]
+        //   and -stats <file.json/file.csv> [-stats-every <seconds>]
         
-        if (argc > 2 && argc < 5) {
+        vector<string> positional;
+        for (int i = 1; i < argc; i++) {
+            string temp = argv[i];
             
-            filename_2 = argv[argc-1];
-            
-            if ((string)argv[1] == "webcam") {
-                cout << "using webcam instead of input file" << endl;
-                video_1.open(0);
-            } else {
-                video_1.open(argv[1]);
-            }
-            for (int i = 0; i < argc; i++) {
-                string temp = argv[i];
-                
-                if (temp == "-display") {
-                    switch (i) {
-                        case 1:
-                            display_vid_1 = true;
-                            video_1.open(argv[2]);
-                            break;
-                        case 2:
-                            display_vid_1 = true;
-                            break;
-                        case 3:
-                            filename_2 = argv[argc-2];
-                            break;
-                    }
+            if (temp == "-display") {
+                display_vid_1 = true;
+            } else if (temp == "-pipeline") {
+                pipeline = true;
+            } else if (temp == "-streams") {
+                streams = true;
+            } else if (temp == "-live" && i + 1 < argc) {
+                live_budget = atof(argv[++i]);
+            } else if (temp == "-clips" && i + 2 < argc) {
+                pre_roll = atoi(argv[++i]);
+                post_roll = atoi(argv[++i]);
+            } else if (temp == "-raw" && i + 2 < argc) {
+                raw_format = argv[++i];
+                if (sscanf(argv[++i], "%dx%d", &raw_size.width, &raw_size.height) != 2 ||
+                    raw_size.width <= 0 || raw_size.height <= 0) {
+                    throw usageMessage(argv[0]);
+                }
+            } else if (temp == "-segments" && i + 1 < argc) {
+                // 0 picks one segment per core
+                segments = max(0, atoi(argv[++i]));
+            } else if (temp == "-overlap" && i + 1 < argc) {
+                overlap = max(0, atoi(argv[++i]));
+            } else if (temp == "-fps" && i + 1 < argc) {
+                raw_fps = atof(argv[++i]);
+            } else if (temp == "-workers" && i + 1 < argc) {
+                workers = atoi(argv[++i]);
+            } else if (temp == "-background" && i + 1 < argc) {
+                background_model = argv[++i];
+            } else if (temp == "-rate" && i + 1 < argc) {
+                learning_rate = atof(argv[++i]);
+            } else if (temp == "-fixed") {
+                settings.threshold_mode = THRESHOLD_FIXED;
+            } else if (temp == "-stats" && i + 1 < argc) {
+                stats_filename = argv[++i];
+            } else if (temp == "-stats-every" && i + 1 < argc) {
+                stats_interval = atof(argv[++i]);
+            } else if (temp == "-track") {
+                settings.track = true;
+            } else if (temp == "-blocks" && i + 1 < argc) {
+                settings.block_thresh = atoi(argv[++i]);
+            } else if (temp == "-tiles" && i + 1 < argc) {
+                // 0 picks one tile per thread
+                settings.tiles = atoi(argv[++i]);
+                if (settings.tiles <= 0) {
+                    settings.tiles = getNumThreads();
                 }
+            } else {
+                positional.push_back(temp);
             }
+        }
+        
+        bool live = live_budget >= 0;
+        bool clips = pre_roll >= 0 && post_roll >= 0;
+        bool raw = !raw_format.empty();
+        bool segmented = segments >= 0;
+        bool valid;
+        
+        if (segmented) {
+            valid = positional.size() == 2 && !display_vid_1 && !pipeline && !streams && !live && !clips && !raw;
+        } else if (raw) {
+            valid = (positional.size() == 1 || positional.size() == 2) && !display_vid_1 && !pipeline &&
+                    !streams && !live && !clips;
+        } else if (streams) {
+            valid = positional.size() >= 2 && !display_vid_1 && !pipeline && !live && !clips;
+        } else if (live) {
+            valid = (positional.size() == 1 || positional.size() == 2) && !display_vid_1 && !pipeline && !clips;
+        } else if (clips) {
+            valid = positional.size() == 2 && !display_vid_1 && !pipeline;
         } else {
-            string error_message;
-            error_message  = "usage: ";
-            error_message += argv[0];
-            error_message += " [-display] <input_video/webcam> [-display]";
-            error_message += " <output_image> [-display] [radius]";
-            error_message += "\n Ensure your -display flag is in the correct location.";
-            error_message += "\n <x/y> : both x and y are interchangable";
-            error_message += "\n [x] : x is singular and optional";
+            valid = positional.size() == 2 && !(pipeline && display_vid_1);
+        }
+        
+        if (!valid) {
+            throw usageMessage(argv[0]);
+        }
+        
+        if (!stats_filename.empty()) {
+            enableStats(stats_filename, stats_interval);
+        }
+        
+        Ptr<BackgroundModel> background = createBackgroundModel(background_model, learning_rate);
+        
+        if (streams) {
+            vector<string> inputs(positional.begin() + 1, positional.end());
+            runStreams(parseStreamSources(inputs, positional[0]), background_model, learning_rate, settings, workers);
             
-            throw error_message;
+            return 0;
+        }
+        
+        filename_1 = positional[0];
+        if (positional.size() > 1) {
+            filename_2 = positional[1];
+        }
+        
+        if (segmented) {
+            runSegments(filename_1, filename_2, background_model, learning_rate, settings, segments, overlap);
+            
+            return 0;
+        }
+        
+        if (raw) {
+            Ptr<RawFrameSource> source = openRawSource(filename_1, parseRawFormat(raw_format), raw_size);
+            runRaw(*source, filename_2, raw_fps, *background, settings);
+            
+            return 0;
+        }
+        
+        if (filename_1 == "webcam") {
+            cout << "using webcam instead of input file" << endl;
+            video_1.open(0);
+        } else {
+            video_1.open(filename_1);
         }
         
         // is video empty?
@@ -128,69 +241,29 @@ int main (int argc, char** argv) {
             throw error_message;
         }
         
-        Mat background;
+        if (live) {
+            runLive(video_1, filename_2, *background, settings, live_budget, filename_1 != "webcam");
+            video_1.release();
+            
+            return 0;
+        }
         
-        video_1 >> background; // take mean of first 3 or 5 frames?
-        cvtColor(background, background, COLOR_RGB2GRAY);
-        imshow("Background", background);
-        medianBlur(background, background, 3);
-        background.convertTo(background, CV_32F);
+        if (clips) {
+            runClips(video_1, filename_2, *background, settings, pre_roll, post_roll);
+            video_1.release();
+            
+            return 0;
+        }
         
-        while(key != 27 && key != 113){ // esc or q
-            Mat frame;
-            video_1 >> frame;
+        if (pipeline) {
+            runPipeline(video_1, filename_2, *background, settings);
+            video_1.release();
             
-            if (!frame.empty()) {
-                imshow("Input Video", frame);
-                
-                if (!background.empty()) {
-                    int area_thresh = 256;
-                    int fore_thresh = 64;
-                    
-                    Mat foreground_mask = getForegroundMask(background, frame, fore_thresh);
-                    Mat clean;
-                    vector<vector<Point> > contours;
-                    vector<Vec4i> hierarchy;
-                    
-                    frame.copyTo(clean, foreground_mask);
-
-                    findContours(foreground_mask, contours, hierarchy, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
-                                        
-                    for (size_t i = 0; i < contours.size(); i++) { // int or size_t?
-                        if (contourArea(contours[i]) > area_thresh) {
-                            drawContours(clean, contours, (int)i, Scalar(0,255,0));
-                        }
-                    }
-
-                    imshow("Foreground", clean);
-
-                    cv::TrackbarCallback cont_callback = [](int pos, void* userdata)  {
-                        int& area_thresh = *(int*) userdata;
-                    };
-
-                    cv::TrackbarCallback fore_callback = [](int pos, void* userdata) {
-                        int& fore_thresh = *(int*) userdata;
-                    };
-                    
-                    cv::createTrackbar("Contour Threshold", "Foreground", NULL, 528, cont_callback);
-                    cv::createTrackbar("Foreground Threshold", "Foreground", NULL, 255, fore_callback);
-                    
-                    // Save video
-                    int fps = video_1.get(CAP_PROP_FPS);
-                    VideoWriter vid_output(filename_2, VideoWriter::fourcc('M', 'P', 'E', 'G'), fps, Size(frame.cols, frame.rows));
-                }
-                
-            } else {
-                video_1.release();
-                video_output.release();
-                throw runtime_error("Video finished or OpenCV cannot read the video file");
-            }
-            waitKey(1);
+            return 0;
         }
         
+        runDisplay(video_1, filename_2, *background, settings, display_vid_1);
         video_1.release();
-        video_output.release();
-        destroyAllWindows();
         
     } catch (const exception& error) {
         // Display an error message in the console
@@ -0,0 +1,90 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       MotionMetadata.cxx
+ *
+ *   @brief      Handle writing the regions found in each frame to a binary side stream
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <cstdint>
+
+#include "MotionMetadata.h"
+
+MetadataWriter::MetadataWriter(const string& filename, Size frame_size, double fps)
+    : out_(filename.c_str(), ios::binary) {
+    if (!out_) {
+        string error_message;
+        error_message  = "Could not create the metadata file \"";
+        error_message += filename;
+        error_message += "\".";
+
+        throw error_message;
+    }
+
+    out_.write("MDMETA1", 8);
+    put((uint32_t) frame_size.width);
+    put((uint32_t) frame_size.height);
+    put(fps);
+}
+
+bool MetadataWriter::write(size_t frame, double timestamp_ms, const vector<Blob>& blobs, int area_thresh) {
+    uint32_t count = 0;
+    for (size_t i = 0; i < blobs.size(); i++) {
+        if (blobs[i].area > area_thresh) {
+            ++count;
+        }
+    }
+
+    if (count == 0) {
+        return false;
+    }
+
+    index_.push_back(make_pair(timestamp_ms, (unsigned long long) out_.tellp()));
+
+    put((uint64_t) frame);
+    put(timestamp_ms);
+    put(count);
+
+    for (size_t i = 0; i < blobs.size(); i++) {
+        if (blobs[i].area <= area_thresh) {
+            continue;
+        }
+
+        const Rect& bounds = blobs[i].bounds;
+        put((uint16_t) bounds.x);
+        put((uint16_t) bounds.y);
+        put((uint16_t) bounds.width);
+        put((uint16_t) bounds.height);
+        put((uint32_t) blobs[i].area);
+    }
+
+    return true;
+}
+
+void MetadataWriter::finish() {
+    if (!out_.is_open()) {
+        return;
+    }
+
+    uint64_t index_offset = out_.tellp();
+
+    for (size_t i = 0; i < index_.size(); i++) {
+        put(index_[i].first);
+        put((uint64_t) index_[i].second);
+    }
+
+    put(index_offset);
+    put((uint64_t) index_.size());
+    out_.write("MDINDEX", 8);
+    out_.close();
+}
+
+MetadataWriter::~MetadataWriter() {
+    finish();
+}
@@ -0,0 +1,189 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       MultiStream.cxx
+ *
+ *   @brief      Handle many cameras or files in one process, fairly sharing one pool of workers
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+
+#include "MultiStream.h"
+#include "BackgroundModel.h"
+#include "ThreadPool.h"
+#include "Stats.h"
+
+struct StreamState {
+    StreamSource source;
+    VideoCapture capture;
+    VideoWriter writer;
+    Ptr<BackgroundModel> background;
+    DetectionContext context;
+    Mat frame;
+    Mat annotated;
+    size_t frames;
+};
+
+static bool isDeviceIndex(const string& input) {
+    return !input.empty() && input.find_first_not_of("0123456789") == string::npos;
+}
+
+static bool endsWith(const string& text, const string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+vector<StreamSource> parseStreamSources(const vector<string>& inputs, const string& output_directory) {
+    vector<StreamSource> streams;
+
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (!endsWith(inputs[i], ".txt")) {
+            StreamSource source;
+            source.input = inputs[i];
+            streams.push_back(source);
+            continue;
+        }
+
+        ifstream manifest(inputs[i].c_str());
+        if (!manifest.is_open()) {
+            string error_message;
+            error_message  = "Could not open the manifest \"";
+            error_message += inputs[i];
+            error_message += "\".";
+
+            throw error_message;
+        }
+
+        string line;
+        while (getline(manifest, line)) {
+            StreamSource source;
+            istringstream fields(line);
+
+            if (fields >> source.input && source.input[0] != '#') {
+                fields >> source.output;
+                streams.push_back(source);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < streams.size(); ++i) {
+        if (streams[i].output.empty()) {
+            stringstream filename;
+            filename << output_directory << "/stream" << i + 1 << ".avi";
+            streams[i].output = filename.str();
+        }
+    }
+
+    return streams;
+}
+
+void runStreams(const vector<StreamSource>& streams, const string& background_model, double learning_rate,
+                const DetectionSettings& settings, size_t workers) {
+    vector<StreamState> states(streams.size());
+    mutex log_mutex;
+
+    for (size_t i = 0; i < streams.size(); ++i) {
+        StreamState& state = states[i];
+        state.source = streams[i];
+        state.frames = 0;
+        state.background = createBackgroundModel(background_model, learning_rate);
+
+        if (state.source.input == "webcam") {
+            state.capture.open(0);
+        } else if (isDeviceIndex(state.source.input)) {
+            state.capture.open(atoi(state.source.input.c_str()));
+        } else {
+            state.capture.open(state.source.input);
+        }
+
+        Mat first_frame;
+        if (state.capture.isOpened()) {
+            state.capture >> first_frame;
+        }
+
+        if (first_frame.empty()) {
+            cerr << "Could not open or find the video \"" << state.source.input << "\", skipping it." << endl;
+            state.capture.release();
+            continue;
+        }
+
+        state.background->initialise(first_frame);
+
+        double fps = state.capture.get(CAP_PROP_FPS);
+        state.writer.open(state.source.output, VideoWriter::fourcc('M', 'P', 'E', 'G'), fps > 0 ? fps : 30,
+                          Size(first_frame.cols, first_frame.rows));
+
+        if (!state.writer.isOpened()) {
+            cerr << "Could not open the output video \"" << state.source.output << "\", skipping it." << endl;
+            state.capture.release();
+        }
+    }
+
+    int64 start = getTickCount();
+
+    {
+        ThreadPool pool(workers);
+
+        // each stream only ever has one task queued, which re-queues itself at the back after a frame
+        function<void(size_t)> step = [&](size_t i) {
+            StreamState& state = states[i];
+
+            try {
+                {
+                    ScopedTimer timer(STAGE_DECODE);
+                    state.capture >> state.frame;
+                }
+
+                if (!state.frame.empty()) {
+                    detectMotion(*state.background, state.frame, settings, state.context, state.annotated);
+                    {
+                        ScopedTimer timer(STAGE_ENCODE);
+                        state.writer.write(state.annotated);
+                    }
+                    ++state.frames;
+
+                    pool.submit([&step, i]() { step(i); });
+                    return;
+                }
+            } catch (const exception& error) {
+                lock_guard<mutex> lock(log_mutex);
+                cerr << "\"" << state.source.input << "\": " << error.what() << endl;
+            } catch (const string& error) {
+                lock_guard<mutex> lock(log_mutex);
+                cerr << "\"" << state.source.input << "\": " << error << endl;
+            }
+
+            state.capture.release();
+            state.writer.release();
+        };
+
+        for (size_t i = 0; i < states.size(); ++i) {
+            if (states[i].capture.isOpened()) {
+                pool.submit([&step, i]() { step(i); });
+            }
+        }
+
+        pool.wait();
+    }
+
+    double seconds = (getTickCount() - start) / getTickFrequency();
+    size_t total_frames = 0;
+
+    for (size_t i = 0; i < states.size(); ++i) {
+        cout << "\"" << states[i].source.input << "\": " << states[i].frames << " frames" << endl;
+        total_frames += states[i].frames;
+    }
+
+    cout << total_frames << " frames from " << states.size() << " streams in " << seconds << "s ("
+         << (seconds > 0 ? total_frames / seconds : 0) << " fps)" << endl;
+}
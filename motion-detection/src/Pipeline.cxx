@@ -0,0 +1,157 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       Pipeline.cxx
+ *
+ *   @brief      Overlap decoding, detection and encoding of a video on three threads
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <iostream>
+#include <thread>
+#include <exception>
+#include <stdexcept>
+
+#include "Pipeline.h"
+#include "Detection.h"
+#include "BoundedQueue.h"
+#include "Stats.h"
+
+void runPipeline(VideoCapture& input, const string& output_filename, BackgroundModel& background,
+                 const DetectionSettings& settings, size_t queue_depth) {
+    Mat first_frame;
+    input >> first_frame;
+
+    if (first_frame.empty()) {
+        throw runtime_error("Video finished or OpenCV cannot read the video file");
+    }
+
+    background.initialise(first_frame);
+
+    double fps = input.get(CAP_PROP_FPS);
+    if (fps <= 0) {
+        fps = 30;
+    }
+
+    VideoWriter video_output(output_filename, VideoWriter::fourcc('M', 'P', 'E', 'G'),
+                             fps, Size(first_frame.cols, first_frame.rows));
+
+    if (!video_output.isOpened()) {
+        string error_message;
+        error_message  = "Could not open the output video \"";
+        error_message += output_filename;
+        error_message += "\".";
+
+        throw error_message;
+    }
+
+    BoundedQueue<Mat> decoded(queue_depth);
+    BoundedQueue<Mat> detected(queue_depth);
+    exception_ptr decode_error;
+    exception_ptr encode_error;
+    size_t frame_count = 0;
+
+    // enough buffers to fill a queue with one in the hands of each stage either side of it.
+    // They go back into their pool once used, so the frame buffers are only ever allocated once
+    size_t pool_size = queue_depth + 2;
+    BoundedQueue<Mat> free_frames(pool_size);
+    BoundedQueue<Mat> free_annotated(pool_size);
+    for (size_t i = 0; i < pool_size; ++i) {
+        free_frames.push(Mat());
+        free_annotated.push(Mat());
+    }
+
+    // closing every queue wakes any stage that is waiting on another
+    auto closeAll = [&]() {
+        decoded.close();
+        detected.close();
+        free_frames.close();
+        free_annotated.close();
+    };
+
+    int64 start = getTickCount();
+
+    // decoder: only touches the capture
+    thread decoder([&]() {
+        try {
+            Mat frame;
+            while (free_frames.pop(frame)) {
+                {
+                    ScopedTimer timer(STAGE_DECODE);
+                    input >> frame;
+                }
+
+                if (frame.empty() || !decoded.push(frame)) {
+                    break;
+                }
+            }
+        } catch (...) {
+            decode_error = current_exception();
+            closeAll();
+        }
+        decoded.close();
+    });
+
+    // encoder: the only owner of the writer
+    thread encoder([&]() {
+        try {
+            Mat annotated;
+            while (detected.pop(annotated)) {
+                {
+                    ScopedTimer timer(STAGE_ENCODE);
+                    video_output.write(annotated);
+                }
+                ++frame_count;
+
+                free_annotated.push(annotated);
+            }
+        } catch (...) {
+            encode_error = current_exception();
+        }
+        // unblock the other stages if we stopped early
+        closeAll();
+    });
+
+    exception_ptr detect_error;
+    try {
+        DetectionContext context;
+        Mat frame;
+        Mat annotated;
+
+        while (decoded.pop(frame) && free_annotated.pop(annotated)) {
+            detectMotion(background, frame, settings, context, annotated);
+            free_frames.push(frame);
+
+            if (!detected.push(annotated)) {
+                break;
+            }
+        }
+    } catch (...) {
+        detect_error = current_exception();
+        closeAll();
+    }
+    detected.close();
+
+    decoder.join();
+    encoder.join();
+    video_output.release();
+
+    if (decode_error) {
+        rethrow_exception(decode_error);
+    }
+    if (detect_error) {
+        rethrow_exception(detect_error);
+    }
+    if (encode_error) {
+        rethrow_exception(encode_error);
+    }
+
+    double seconds = (getTickCount() - start) / getTickFrequency();
+    cout << frame_count << " frames in " << seconds << "s ("
+         << (seconds > 0 ? frame_count / seconds : 0) << " fps)" << endl;
+}
@@ -0,0 +1,267 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       RawInput.cxx
+ *
+ *   @brief      Handle reading raw frames from stdin, named pipes and shared memory rings
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "RawInput.h"
+#include "Stats.h"
+
+static string systemError(const string& what, const string& path) {
+    string error_message;
+    error_message  = what;
+    error_message += " \"";
+    error_message += path;
+    error_message += "\": ";
+    error_message += strerror(errno);
+
+    return error_message;
+}
+
+RawFormat parseRawFormat(const string& name) {
+    if (name == "bgr") {
+        return RAW_BGR;
+    }
+    if (name == "y8") {
+        return RAW_Y8;
+    }
+    if (name == "nv12") {
+        return RAW_NV12;
+    }
+    if (name == "i420") {
+        return RAW_I420;
+    }
+
+    string error_message;
+    error_message  = "Unknown raw format \"";
+    error_message += name;
+    error_message += "\". Use bgr, y8, nv12 or i420.";
+
+    throw error_message;
+}
+
+size_t rawFrameBytes(RawFormat format, Size size) {
+    size_t pixels = (size_t) size.width * size.height;
+
+    switch (format) {
+        case RAW_BGR:
+            return pixels * 3;
+        case RAW_Y8:
+            return pixels;
+        case RAW_NV12:
+        case RAW_I420:
+            if (size.width % 2 || size.height % 2) {
+                throw runtime_error("NV12 and I420 frames must have an even width and height");
+            }
+            return pixels * 3 / 2;
+    }
+
+    return 0;
+}
+
+// BGR frames are the whole buffer, everything else is just the luma plane at the start of it
+static Mat frameHeader(RawFormat format, Size size, uchar* data) {
+    return Mat(size, format == RAW_BGR ? CV_8UC3 : CV_8UC1, data);
+}
+
+PipeFrameSource::PipeFrameSource(const string& path, RawFormat format, Size size)
+    : fd_(0), owns_fd_(false), format_(format), size_(size) {
+    if (path != "-") {
+        fd_ = open(path.c_str(), O_RDONLY);
+
+        if (fd_ < 0) {
+            throw systemError("Could not open the raw input", path);
+        }
+        owns_fd_ = true;
+    }
+
+    buffer_.create(1, (int) rawFrameBytes(format, size), CV_8UC1);
+}
+
+PipeFrameSource::~PipeFrameSource() {
+    if (owns_fd_) {
+        close(fd_);
+    }
+}
+
+bool PipeFrameSource::read(Mat& frame) {
+    uchar* data = buffer_.ptr<uchar>();
+    size_t total = buffer_.cols;
+    size_t filled = 0;
+
+    // a pipe hands back whatever has been written so far, so keep reading until the frame is whole
+    while (filled < total) {
+        ssize_t got = ::read(fd_, data + filled, total - filled);
+
+        if (got == 0) {
+            return false; // a partial last frame is dropped
+        }
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw systemError("Could not read the raw input", owns_fd_ ? "file" : "stdin");
+        }
+
+        filled += got;
+    }
+
+    frame = frameHeader(format_, size_, data);
+
+    return true;
+}
+
+SharedMemoryFrameSource::SharedMemoryFrameSource(const string& name, RawFormat format, Size size)
+    : mapping_(0), mapping_bytes_(0), header_(0), format_(format), size_(size), next_(0), holding_(false) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+
+    if (fd < 0) {
+        throw systemError("Could not open the shared memory ring", name);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) < 0 || (size_t) info.st_size < RAW_RING_DATA_OFFSET) {
+        close(fd);
+        throw string("The shared memory ring \"") + name + "\" is too small to hold its header.";
+    }
+
+    mapping_bytes_ = info.st_size;
+    void* mapping = mmap(0, mapping_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        throw systemError("Could not map the shared memory ring", name);
+    }
+
+    mapping_ = (uchar*) mapping;
+    header_ = (RawRingHeader*) mapping;
+
+    size_t frame_bytes = rawFrameBytes(format, size);
+    bool valid = memcmp(header_->magic, "RAWRING", 8) == 0 && header_->slots > 0 &&
+                 header_->width == (uint32_t) size.width && header_->height == (uint32_t) size.height &&
+                 header_->format == (uint32_t) format && header_->frame_bytes >= frame_bytes &&
+                 RAW_RING_DATA_OFFSET + header_->slots * header_->frame_bytes <= mapping_bytes_;
+
+    if (!valid) {
+        munmap(mapping_, mapping_bytes_);
+
+        string error_message;
+        error_message  = "The shared memory ring \"";
+        error_message += name;
+        error_message += "\" does not hold frames of the given size and format.";
+
+        throw error_message;
+    }
+
+    // start from the oldest frame still in the ring
+    next_ = header_->read.load();
+}
+
+SharedMemoryFrameSource::~SharedMemoryFrameSource() {
+    if (holding_) {
+        header_->read.store(next_);
+    }
+    munmap(mapping_, mapping_bytes_);
+}
+
+bool SharedMemoryFrameSource::read(Mat& frame) {
+    // the previous frame is finished with, so the producer can have its slot back
+    if (holding_) {
+        header_->read.store(next_);
+        holding_ = false;
+    }
+
+    while (header_->written.load() <= next_) {
+        if (header_->closed.load()) {
+            return false;
+        }
+        this_thread::sleep_for(chrono::microseconds(200));
+    }
+
+    uchar* slot = mapping_ + RAW_RING_DATA_OFFSET + (next_ % header_->slots) * header_->frame_bytes;
+    frame = frameHeader(format_, size_, slot);
+
+    ++next_;
+    holding_ = true;
+
+    return true;
+}
+
+Ptr<RawFrameSource> openRawSource(const string& source, RawFormat format, Size size) {
+    if (source.compare(0, 4, "shm:") == 0) {
+        return makePtr<SharedMemoryFrameSource>(source.substr(4), format, size);
+    }
+
+    return makePtr<PipeFrameSource>(source, format, size);
+}
+
+void runRaw(RawFrameSource& source, const string& output_filename, double fps, BackgroundModel& background,
+            const DetectionSettings& settings) {
+    Mat frame;
+
+    if (!source.read(frame)) {
+        throw runtime_error("The raw input ended before the first frame");
+    }
+
+    background.initialise(frame);
+
+    VideoWriter video_output;
+
+    if (!output_filename.empty()) {
+        video_output.open(output_filename, VideoWriter::fourcc('M', 'P', 'E', 'G'), fps,
+                          frame.size(), frame.channels() == 3);
+
+        if (!video_output.isOpened()) {
+            string error_message;
+            error_message  = "Could not open the output video \"";
+            error_message += output_filename;
+            error_message += "\".";
+
+            throw error_message;
+        }
+    }
+
+    DetectionContext context;
+    Mat annotated;
+    size_t frame_count = 0;
+
+    while (true) {
+        {
+            ScopedTimer timer(STAGE_DECODE);
+            if (!source.read(frame)) {
+                break;
+            }
+        }
+
+        detectMotion(background, frame, settings, context, annotated);
+        ++frame_count;
+
+        if (video_output.isOpened()) {
+            ScopedTimer timer(STAGE_ENCODE);
+            video_output.write(annotated);
+        }
+    }
+
+    video_output.release();
+
+    cout << frame_count << " raw frames processed" << endl;
+}
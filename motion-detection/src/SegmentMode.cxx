@@ -0,0 +1,245 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       SegmentMode.cxx
+ *
+ *   @brief      Handle splitting one long video into segments that are processed in parallel
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include <exception>
+#include <stdexcept>
+
+#include "SegmentMode.h"
+#include "BackgroundModel.h"
+#include "MotionMetadata.h"
+#include "ThreadPool.h"
+#include "Stats.h"
+
+// the regions over the area threshold in one frame
+struct SegmentEvent {
+    size_t frame;
+    vector<Blob> blobs;
+};
+
+struct Segment {
+    Segment() : start(0), end(0), frames(0) {}
+
+    size_t start;       // first frame written
+    size_t end;         // one past the last frame written
+    string filename;
+
+    size_t frames;
+    vector<SegmentEvent> events;
+    exception_ptr error;
+};
+
+static string segmentName(size_t index) {
+    char name[32];
+    snprintf(name, sizeof(name), "segment%03d.avi", (int) index);
+
+    return name;
+}
+
+/**
+ * Detect over one segment, with the background seeded from the video's first frame and,
+ * for a background that changes, warmed up over the frames before the segment.
+ *
+ * @param first_frame: Frame 0 of the video, the background every segment starts from.
+ * @param segment: The frames to process. The frame count and events are filled in.
+ */
+static void runSegment(const string& input_filename, const string& output_directory, const string& background_model,
+                       double learning_rate, const DetectionSettings& settings, int overlap, double fps,
+                       const Mat& first_frame, Segment& segment) {
+    VideoCapture input(input_filename);
+
+    if (!input.isOpened()) {
+        throw runtime_error("Could not open \"" + input_filename + "\" for a segment");
+    }
+
+    Ptr<BackgroundModel> background = createBackgroundModel(background_model, learning_rate);
+    background->initialise(first_frame);
+
+    // a static background is frame 0 for the whole video, so it needs no warm-up. One that learns,
+    // or that -track absorbs regions into, is brought closer to where a serial run would have it
+    // at the segment's start by running over the frames before it
+    size_t warm_up = 0;
+    if (background->adapts() || settings.track) {
+        warm_up = min(segment.start - 1, (size_t) max(overlap, 0));
+    }
+    size_t first = segment.start - warm_up;
+
+    Mat frame;
+    if (first == 1) {
+        // frame 0 is the background already, so skip it rather than seek
+        ScopedTimer timer(STAGE_DECODE);
+        input >> frame;
+    } else if (!input.set(CAP_PROP_POS_FRAMES, (double) first)) {
+        throw runtime_error("Could not seek \"" + input_filename + "\", so it cannot be split into segments");
+    }
+
+    string output_filename = output_directory + "/" + segment.filename;
+    VideoWriter output(output_filename, VideoWriter::fourcc('M', 'P', 'E', 'G'), fps,
+                       Size(first_frame.cols, first_frame.rows));
+
+    if (!output.isOpened()) {
+        string error_message;
+        error_message  = "Could not open the output video \"";
+        error_message += output_filename;
+        error_message += "\".";
+
+        throw error_message;
+    }
+
+    DetectionContext context;
+    Mat annotated;
+
+    for (size_t index = first; index < segment.end; ++index) {
+        {
+            ScopedTimer timer(STAGE_DECODE);
+            input >> frame;
+        }
+
+        if (frame.empty()) {
+            break;
+        }
+
+        detectMotion(*background, frame, settings, context, annotated);
+
+        // the overlap only trains the background and tracks
+        if (index < segment.start) {
+            continue;
+        }
+
+        ++segment.frames;
+
+        {
+            ScopedTimer timer(STAGE_ENCODE);
+            output.write(annotated);
+        }
+
+        SegmentEvent event;
+        event.frame = index;
+        for (size_t i = 0; i < context.blobs.size(); ++i) {
+            if (context.blobs[i].area > settings.area_thresh) {
+                event.blobs.push_back(context.blobs[i]);
+            }
+        }
+
+        if (!event.blobs.empty()) {
+            segment.events.push_back(event);
+        }
+    }
+}
+
+void runSegments(const string& input_filename, const string& output_directory, const string& background_model,
+                 double learning_rate, const DetectionSettings& settings, size_t segments, int overlap) {
+    VideoCapture probe(input_filename);
+
+    if (!probe.isOpened()) {
+        string error_message;
+        error_message  = "Could not open or find the video \"";
+        error_message += input_filename;
+        error_message += "\".";
+
+        throw error_message;
+    }
+
+    double frame_count = probe.get(CAP_PROP_FRAME_COUNT);
+    double fps = probe.get(CAP_PROP_FPS);
+
+    // read once and shared, so every segment compares against the same background a serial run would
+    Mat first_frame;
+    {
+        ScopedTimer timer(STAGE_DECODE);
+        probe >> first_frame;
+    }
+    probe.release();
+
+    if (first_frame.empty()) {
+        throw runtime_error("Video finished or OpenCV cannot read the video file");
+    }
+    Size frame_size(first_frame.cols, first_frame.rows);
+
+    if (frame_count < 2) {
+        throw runtime_error("\"" + input_filename + "\" does not report its frame count, so it cannot be split into segments");
+    }
+    if (fps <= 0) {
+        fps = 30;
+    }
+
+    ThreadPool pool;
+    if (segments == 0) {
+        segments = pool.size();
+    }
+
+    // frame 0 is only the background, as it is when the video is processed in one go
+    size_t frames = (size_t) frame_count;
+    segments = min(segments, frames - 1);
+
+    vector<Segment> parts(segments);
+    for (size_t i = 0; i < segments; ++i) {
+        parts[i].start = 1 + (frames - 1) * i / segments;
+        parts[i].end = 1 + (frames - 1) * (i + 1) / segments;
+        parts[i].filename = segmentName(i);
+    }
+
+    // the frame count can be an estimate, so the last segment reads to the end of the file
+    parts[segments - 1].end = numeric_limits<size_t>::max();
+
+    int64 start_ticks = getTickCount();
+
+    for (size_t i = 0; i < segments; ++i) {
+        Segment* segment = &parts[i];
+        pool.submit([&, segment]() {
+            try {
+                runSegment(input_filename, output_directory, background_model, learning_rate, settings, overlap,
+                           fps, first_frame, *segment);
+            } catch (...) {
+                segment->error = current_exception();
+            }
+        });
+    }
+    pool.wait();
+
+    for (size_t i = 0; i < segments; ++i) {
+        if (parts[i].error) {
+            rethrow_exception(parts[i].error);
+        }
+    }
+
+    // merge in order: the segments' events into one metadata file, and the list of segment videos
+    MetadataWriter metadata(output_directory + "/metadata.bin", frame_size, fps);
+    ofstream list((output_directory + "/segments.txt").c_str());
+    size_t processed = 0;
+    size_t events = 0;
+
+    for (size_t i = 0; i < segments; ++i) {
+        const Segment& segment = parts[i];
+
+        for (size_t e = 0; e < segment.events.size(); ++e) {
+            const SegmentEvent& event = segment.events[e];
+            metadata.write(event.frame, event.frame * 1000 / fps, event.blobs, settings.area_thresh);
+        }
+
+        list << "file '" << segment.filename << "'" << endl;
+        processed += segment.frames;
+        events += segment.events.size();
+    }
+
+    metadata.finish();
+
+    double seconds = (getTickCount() - start_ticks) / getTickFrequency();
+    cout << processed << " frames processed in " << segments << " segments in " << seconds << " s ("
+         << processed / seconds << " frames/s), " << events << " frames with motion" << endl;
+}
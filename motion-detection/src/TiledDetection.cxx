@@ -0,0 +1,131 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       TiledDetection.cxx
+ *
+ *   @brief      Handle splitting the detection of a frame into horizontal tiles processed in parallel
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <algorithm>
+
+#include "TiledDetection.h"
+#include "ForegroundKernels.h"
+#include "AllocationCounter.h"
+#include "Stats.h"
+
+static Range tileRows(int rows, int tiles, int tile) {
+    return Range(rows * tile / tiles, rows * (tile + 1) / tiles);
+}
+
+static Range haloRows(const Range& core, int halo, int rows) {
+    return Range(max(0, core.start - halo), min(rows, core.end + halo));
+}
+
+const Mat& getForegroundMaskTiled(BackgroundModel& background, const Mat& next_frame,
+                                  const DetectionSettings& settings, DetectionContext& context) {
+    CV_Assert(next_frame.type() == CV_8UC3 || next_frame.type() == CV_8UC1);
+
+    int rows = next_frame.rows;
+    int tiles = max(1, min(settings.tiles, rows));
+    int aThreshold = settings.fore_thresh;
+    ThresholdMode mode = settings.threshold_mode;
+
+    const Mat& bg = background.background();
+    context.gray.create(next_frame.size(), CV_8UC1);
+    context.difference.create(next_frame.size(), CV_8UC1);
+    context.mask.create(next_frame.size(), CV_8UC1);
+
+    context.tile_gray.resize(tiles);
+    context.tile_blur.resize(tiles);
+    context.tile_mask.resize(tiles);
+    context.tile_clean.resize(tiles);
+    context.tile_min.assign(tiles, 255);
+    context.tile_max.assign(tiles, 0);
+
+    // the tiles' Mats are charged to the frame, whichever thread makes them
+    std::atomic<size_t>* allocations = AllocationScope::current();
+
+    // pass 1: gray, blur and difference. The normalised mode needs the range of the whole frame before it can threshold
+    parallel_for_(Range(0, tiles), [&](const Range& range) {
+        AllocationScope tile_allocations(allocations);
+
+        for (int t = range.start; t < range.end; ++t) {
+            Range core = tileRows(rows, tiles, t);
+            Range halo = haloRows(core, MEDIAN_HALO, rows);
+            Range inner(core.start - halo.start, core.end - halo.start);
+
+            if (mode == THRESHOLD_FIXED) {
+                {
+                    ScopedTimer timer(STAGE_DIFFERENCE);
+                    fusedForegroundMask(next_frame.rowRange(halo), bg.rowRange(halo),
+                                        context.tile_gray[t], context.tile_mask[t], aThreshold);
+                }
+                {
+                    ScopedTimer timer(STAGE_GRAY_BLUR);
+                    medianBlur(context.tile_mask[t], context.tile_blur[t], 5);
+                }
+
+                context.tile_gray[t].rowRange(inner).copyTo(context.gray.rowRange(core));
+                context.tile_blur[t].rowRange(inner).copyTo(context.difference.rowRange(core));
+            } else {
+                {
+                    ScopedTimer timer(STAGE_GRAY_BLUR);
+                    if (next_frame.channels() == 1) {
+                        medianBlur(next_frame.rowRange(halo), context.tile_blur[t], 5);
+                    } else {
+                        cvtColor(next_frame.rowRange(halo), context.tile_gray[t], COLOR_BGR2GRAY);
+                        medianBlur(context.tile_gray[t], context.tile_blur[t], 5);
+                    }
+                }
+
+                context.tile_blur[t].rowRange(inner).copyTo(context.gray.rowRange(core));
+
+                ScopedTimer timer(STAGE_DIFFERENCE);
+                Mat difference_rows = context.difference.rowRange(core);
+                absDiffRange(context.gray.rowRange(core), bg.rowRange(core), difference_rows,
+                             context.tile_min[t], context.tile_max[t]);
+            }
+        }
+    });
+
+    int min_value = *min_element(context.tile_min.begin(), context.tile_min.end());
+    int max_value = *max_element(context.tile_max.begin(), context.tile_max.end());
+
+    // pass 2: threshold and clean, then learn from the frame now nothing else reads the background
+    parallel_for_(Range(0, tiles), [&](const Range& range) {
+        AllocationScope tile_allocations(allocations);
+
+        for (int t = range.start; t < range.end; ++t) {
+            Range core = tileRows(rows, tiles, t);
+            Range halo = haloRows(core, CLEAN_HALO, rows);
+            Range inner(core.start - halo.start, core.end - halo.start);
+
+            if (mode == THRESHOLD_FIXED) {
+                ScopedTimer timer(STAGE_MORPHOLOGY);
+                cleanBinaryImage(context.difference.rowRange(halo), context.tile_clean[t],
+                                 context.close_element, context.open_element);
+            } else {
+                {
+                    ScopedTimer timer(STAGE_DIFFERENCE);
+                    thresholdNormalised(context.difference.rowRange(halo), context.tile_mask[t], min_value, max_value, aThreshold);
+                }
+                ScopedTimer timer(STAGE_MORPHOLOGY);
+                cleanBinaryImage(context.tile_mask[t], context.tile_clean[t],
+                                 context.close_element, context.open_element);
+            }
+
+            context.tile_clean[t].rowRange(inner).copyTo(context.mask.rowRange(core));
+
+            background.updateRows(context.gray, core);
+        }
+    });
+    context.compared = context.gray;
+
+    return context.mask;
+}
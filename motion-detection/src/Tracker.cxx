@@ -0,0 +1,129 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       Tracker.cxx
+ *
+ *   @brief      Handle following blobs across frames and retiring the ones that stop moving
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <cmath>
+
+#include "Tracker.h"
+
+Tracker::Tracker(float match_distance, float still_distance, int still_frames, int max_missed)
+    : match_distance_(match_distance), still_distance_(still_distance),
+      still_frames_(still_frames), max_missed_(max_missed), next_id_(0) {
+}
+
+long long Tracker::cellKey(const Point2f& point) const {
+    long long x = (long long)floor(point.x / match_distance_);
+    long long y = (long long)floor(point.y / match_distance_);
+
+    return (x << 32) ^ (y & 0xffffffffLL);
+}
+
+void Tracker::update(const vector<Blob>& blobs, int min_area) {
+    retired_.clear();
+
+    // cells are as wide as the match distance, so any match is in the 3x3 cells around a blob.
+    // Cells are emptied rather than erased so their storage is reused
+    for (unordered_map<long long, vector<int> >::iterator cell = grid_.begin(); cell != grid_.end(); ++cell) {
+        cell->second.clear();
+    }
+
+    size_t existing = tracks_.size();
+    for (size_t i = 0; i < existing; ++i) {
+        grid_[cellKey(tracks_[i].position + tracks_[i].velocity)].push_back((int)i);
+    }
+    matched_.assign(existing, 0);
+
+    for (size_t b = 0; b < blobs.size(); ++b) {
+        const Blob& blob = blobs[b];
+        if (blob.area <= min_area) {
+            continue;
+        }
+
+        int best = -1;
+        float best_distance = match_distance_;
+
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                Point2f probe(blob.centroid.x + dx * match_distance_, blob.centroid.y + dy * match_distance_);
+                unordered_map<long long, vector<int> >::const_iterator cell = grid_.find(cellKey(probe));
+                if (cell == grid_.end()) {
+                    continue;
+                }
+
+                for (size_t c = 0; c < cell->second.size(); ++c) {
+                    int i = cell->second[c];
+                    if (matched_[i]) {
+                        continue;
+                    }
+
+                    Point2f offset = blob.centroid - (tracks_[i].position + tracks_[i].velocity);
+                    float distance = sqrt(offset.dot(offset));
+                    if (distance < best_distance) {
+                        best_distance = distance;
+                        best = i;
+                    }
+                }
+            }
+        }
+
+        if (best < 0) {
+            Track track;
+            track.id = next_id_++;
+            track.position = blob.centroid;
+            track.velocity = Point2f(0, 0);
+            track.bounds = blob.bounds;
+            track.area = blob.area;
+            track.orientation = blob.orientation();
+            track.age = 0;
+            track.missed = 0;
+            track.still = 0;
+            tracks_.push_back(track);
+            continue;
+        }
+
+        Track& track = tracks_[best];
+        Point2f movement = blob.centroid - track.position;
+
+        matched_[best] = 1;
+        track.velocity = 0.5f * track.velocity + 0.5f * movement;
+        track.position = blob.centroid;
+        track.bounds = blob.bounds;
+        track.area = blob.area;
+        track.orientation = blob.orientation();
+        track.missed = 0;
+        track.still = sqrt(movement.dot(movement)) < still_distance_ ? track.still + 1 : 0;
+        ++track.age;
+    }
+
+    // drop lost tracks and retire still ones, keeping the rest in order
+    size_t kept = 0;
+    for (size_t i = 0; i < tracks_.size(); ++i) {
+        Track& track = tracks_[i];
+
+        if (i < existing && !matched_[i]) {
+            ++track.missed;
+            ++track.age;
+        }
+
+        if (track.missed > max_missed_) {
+            continue;
+        }
+        if (track.still >= still_frames_) {
+            retired_.push_back(track.bounds);
+            continue;
+        }
+
+        tracks_[kept++] = track;
+    }
+    tracks_.resize(kept);
+}
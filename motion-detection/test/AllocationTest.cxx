@@ -0,0 +1,123 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       AllocationTest.cxx
+ *
+ *   @brief      Checks that detecting motion allocates no Mat buffers once the context has warmed up, on every path
+ *
+ *   @date       20.03.20
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+#include "Detection.h"
+#include "BackgroundModel.h"
+#include "AllocationCounter.h"
+
+// the first frames size every buffer, after that none should be made
+static const size_t WARM_UP_FRAMES = 2;
+static const size_t TEST_FRAMES = 10;
+
+/**
+ * A gray scene with a square moving across it, so every frame has something to detect.
+ */
+static Mat syntheticFrame(Size size, size_t index) {
+    Mat frame(size, CV_8UC3, Scalar(90, 100, 110));
+    rectangle(frame, Rect(20 + 12 * (int) index, 40, 48, 48), Scalar(230, 220, 210), FILLED);
+
+    return frame;
+}
+
+/**
+ * Run a few frames through detectMotion and count the frames after warm-up that allocated.
+ *
+ * @param neighbour: Keep another thread allocating Mats the whole time, as a decoder or another
+ *                   stream would, none of which should be charged to the frames.
+ * @return true if none did.
+ */
+static bool runFrames(const string& name, const string& model, const DetectionSettings& settings,
+                      bool neighbour = false) {
+    atomic<bool> stop(false);
+    thread allocating;
+    if (neighbour) {
+        allocating = thread([&]() {
+            while (!stop) {
+                Mat scratch(240, 320, CV_8UC3);
+                scratch.setTo(Scalar::all(0));
+            }
+        });
+    }
+
+    Size size(320, 240);
+    Ptr<BackgroundModel> background = createBackgroundModel(model);
+    background->initialise(syntheticFrame(size, 0));
+
+    DetectionContext context;
+    Mat annotated;
+    size_t failures = 0;
+
+    for (size_t i = 1; i <= TEST_FRAMES; ++i) {
+        detectMotion(*background, syntheticFrame(size, i), settings, context, annotated);
+
+        if (context.frames > WARM_UP_FRAMES && context.frame_allocations > 0) {
+            cerr << name << ": frame " << context.frames << " allocated "
+                 << context.frame_allocations << " Mat buffers" << endl;
+            ++failures;
+        }
+    }
+
+    if (neighbour) {
+        stop = true;
+        allocating.join();
+    }
+
+    cout << name << ": " << (failures ? "FAILED" : "ok") << endl;
+
+    return failures == 0;
+}
+
+int main() {
+    installAllocationCounter();
+
+    if (!allocationCounting()) {
+        cerr << "built without COUNT_ALLOCATIONS, nothing to check" << endl;
+        return 1;
+    }
+
+    bool passed = true;
+
+    DetectionSettings settings;
+    passed &= runFrames("normalised/static", "static", settings);
+    passed &= runFrames("normalised/average", "average", settings);
+
+    settings.threshold_mode = THRESHOLD_FIXED;
+    passed &= runFrames("fixed/static", "static", settings);
+
+    // the tiles run on parallel_for_ workers, whose Mats still count towards the frame
+    DetectionSettings tiled;
+    tiled.tiles = 4;
+    passed &= runFrames("normalised/tiles", "static", tiled);
+    tiled.threshold_mode = THRESHOLD_FIXED;
+    passed &= runFrames("fixed/tiles", "static", tiled);
+
+    DetectionSettings blocks;
+    blocks.block_thresh = 8;
+    passed &= runFrames("normalised/blocks", "static", blocks);
+    blocks.threshold_mode = THRESHOLD_FIXED;
+    passed &= runFrames("fixed/blocks", "static", blocks);
+
+    DetectionSettings tracked;
+    tracked.track = true;
+    passed &= runFrames("normalised/track", "average", tracked);
+
+    // another thread allocating throughout, as the pipeline's decoder or a second stream does
+    passed &= runFrames("normalised/tiles/neighbour", "static", tiled, true);
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,46 @@
+#ifndef __BatchBlend_h
+#define __BatchBlend_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       BatchBlend.h
+ *
+ *   @brief      Header file for BatchBlend.cxx to declare blending a manifest of image pairs headless
+ *
+ *   @date       11/02/21
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <string>
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+using namespace cv;
+
+/**
+ * Blend every job in a manifest, with no windows. Each line of the manifest is one job,
+ *
+ *     <image_1> <image_2> <mask/-> <output> [levels]
+ *
+ * separated by spaces, where a mask of - takes the left half from the first image and the
+ * right half from the second. Blank lines and lines starting with # are skipped.
+ *
+ * The images are read and written on io_threads threads and blended on workers threads,
+ * joined by bounded queues, so one job decodes while another blends and another encodes.
+ * A job that fails is reported and the rest carry on.
+ *
+ * @param manifest_filename: The manifest listing the jobs.
+ * @param level_number: The levels below the base for jobs that do not give their own.
+ * @param workers: The number of threads blending, 0 for one per core.
+ * @param io_threads: The number of threads reading, and the number writing, images.
+ * @param fixed_point: Blend on the CV_8U/CV_16S path instead of converting the images to CV_32F.
+ * @return The number of jobs that failed.
+ */
+size_t runBatch(const string& manifest_filename, size_t level_number, size_t workers, size_t io_threads,
+                bool fixed_point);
+
+#endif // __BatchBlend_h
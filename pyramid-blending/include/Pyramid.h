@@ -18,11 +18,52 @@
  */
 
 #include <vector>
+#include <functional>
 #include <opencv2/opencv.hpp>
 
 using namespace std;
 using namespace cv;
 
+/*
+ * Every pyramid function works on either of two paths, picked by the depth of the image:
+ *
+ *   float:        CV_32F images give CV_32F gaussian and laplacian levels.
+ *   fixed point:  CV_8U images give CV_8U gaussian levels and CV_16S laplacian levels, using
+ *                 OpenCV's integer 5-tap kernels (weights summing to 256 down and 64 up, rounded).
+ *                 Half the memory of CV_32F and twice the SIMD lanes.
+ *
+ * On the fixed point path a laplacian pyramid reconstructs to exactly the image it was made
+ * from, as the rounding in pyrUp is the same for both. blend differs from the float path, on
+ * the same 8-bit images, by at most FIXED_POINT_BLEND_ERROR gray levels (about half a level
+ * on average), from rounding the gaussian levels and the mask weights. Fixed-Point-Test checks both.
+ */
+static const int FIXED_POINT_BLEND_ERROR = 4;
+
+/**
+ * The size of the level below one of the given size: half, rounded up, which is pyrDown's
+ * own default. pyrUp of that level back to the given size is always valid, so pyramids of
+ * any size need no padding.
+ *
+ * @param size: The size of the finer level.
+ */
+Size pyramidLevelSize(Size size);
+
+/**
+ * The most levels below the base a pyramid of the given size can have: the smallest is then
+ * 1x1, and any more would only repeat it. The pyramid builders clamp to this.
+ *
+ * @param size: The size of the base.
+ */
+size_t maxLevelNumber(Size size);
+
+/**
+ * The depth a laplacian pyramid of an image is kept in: CV_16S for CV_8U and CV_16S images,
+ * so the differences can be negative, and the depth of the image itself for CV_32F and CV_64F.
+ *
+ * @param depth: The depth of the image.
+ */
+int laplacianDepth(int depth);
+
 /**
  * Generates a gaussian pyramid from an image
  *
@@ -36,19 +77,74 @@ void createGaussianPyramid(const Mat& input_image, vector<Mat>& gauss_pyramid, s
  * Generates a laplacian pyramid from a given gaussian pyramid
  *
  * @param gauss_pyramid: The input pyramid to be turned into laplacian pyramid.
- * @param laplac_pyramid: The output pyramid.
+ * @param laplac_pyramid: The output pyramid, in laplacianDepth of the gaussian pyramid's depth.
  *
  */
 void createLaplacianPyramid(const vector<Mat>& gauss_pyramid, vector<Mat>& laplac_pyramid);
 
 /**
  * Reconstruct a laplacian pyramid at any level within the pyramid.
+ * The result has the pyramid's depth, so convert a CV_16S one back to CV_8U to save it.
  *
  * @param laplac_pyramid: The pyramid with the desired level to reconstruct.
  * @param aLevel: The level within the pyramid to reconstruct.
  */
 Mat reconstruct(const vector<Mat>& laplac_pyramid, int aLevel);
 
+/**
+ * Collapse a laplacian pyramid once, from the smallest level up, handing every intermediate
+ * reconstruction to a callback as soon as it is made. Returning false from the callback stops
+ * the collapse there, so a coarse preview costs only the levels up to it.
+ *
+ * @param laplac_pyramid: The pyramid to collapse, smallest level first.
+ * @param on_level: Called with each reconstruction and its level, counted as for reconstruct's
+ *                  aLevel, so the last call is level 0 at full size. The image is only valid
+ *                  during the call; clone it to keep it.
+ */
+void reconstructProgressive(const vector<Mat>& laplac_pyramid, const function<bool(const Mat&, size_t)>& on_level);
+
+/**
+ * Collapse a laplacian pyramid once, keeping every intermediate reconstruction.
+ *
+ * @param laplac_pyramid: The pyramid to collapse, smallest level first.
+ * @param reconstructions: Output, the reconstruction at each level in the same order as the pyramid,
+ *                         so the last is full size. Mats already the right size are written over in place.
+ */
+void reconstructLevels(const vector<Mat>& laplac_pyramid, vector<Mat>& reconstructions);
+
+/**
+ * The largest reconstruction no wider than max_width, collapsing no further than it.
+ * The smallest level is returned if even that is wider.
+ *
+ * @param laplac_pyramid: The pyramid to collapse, smallest level first.
+ * @param max_width: The widest the preview may be.
+ */
+Mat reconstructPreview(const vector<Mat>& laplac_pyramid, int max_width);
+
+/**
+ * Multi-band blend two images through a mask. The mask's gaussian pyramid weights the two
+ * laplacian pyramids level by level, and each blended level is added straight into the
+ * image being collapsed from the smallest level up, so no blended pyramid is ever stored.
+ *
+ * @param image_1: The CV_32F or CV_8U image taken where the mask is 1.
+ * @param image_2: The image taken where the mask is 0, the same size and type as image_1.
+ * @param mask: A single channel mask the size of the images, CV_32F from 0 to 1 or CV_8U from 0 to 255.
+ * @param level_number: The number of levels below the base.
+ * @return The blended image, the same type as the images.
+ */
+Mat blend(const Mat& image_1, const Mat& image_2, const Mat& mask, size_t level_number);
+
+/**
+ * Multi-band blend two laplacian pyramids through a mask, the same as blend does with the
+ * pyramids of two images, for pyramids that were built already, such as cached ones.
+ *
+ * @param lapl_pyramid_1: The pyramid taken where the mask is 1, smallest level first, CV_32F or CV_16S.
+ * @param lapl_pyramid_2: The pyramid taken where the mask is 0, with the same level sizes and type.
+ * @param mask: A single channel mask the size of the pyramids' base, CV_32F from 0 to 1 or CV_8U from 0 to 255.
+ * @return The blended image, CV_8U for CV_16S pyramids and the pyramids' own type for CV_32F.
+ */
+Mat blend(const vector<Mat>& lapl_pyramid_1, const vector<Mat>& lapl_pyramid_2, const Mat& mask);
+
 /**
  * Create an image thats a visual representation of the pyramid.
  *
@@ -65,7 +161,8 @@ Mat visualisePyramid(const vector<Mat>& pyramid);
 void swapHalves(Mat& image_1, Mat& image_2);
 
 /**
- * Check if an integer is power of two
+ * Check if an integer is power of two. The pyramids no longer need one; a power of two
+ * size just halves all the way down without any rounding.
  *
  * @param i: Integer to check is power of two.
  */
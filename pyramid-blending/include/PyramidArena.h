@@ -0,0 +1,94 @@
+#ifndef __PyramidArena_h
+#define __PyramidArena_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       PyramidArena.h
+ *
+ *   @brief      Header file for PyramidArena.cxx to declare a pyramid whose levels share one allocation
+ *
+ *   @date       11/02/21
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+using namespace cv;
+
+/**
+ * A gaussian or laplacian pyramid with every level stored in one block of memory, each
+ * level starting on a 64 byte boundary. A gaussian pyramid's base is the input image
+ * itself, so its block holds only the levels below it, about 1/3 the size of the base. A
+ * laplacian pyramid's block holds every level, about 4/3 the base, plus a scratch row the
+ * size of the base for the expanded level being subtracted. Both are kept between builds,
+ * so building pyramids of the same size again allocates no image memory. The levels are Mats onto the block and share its reference count, so they
+ * stay valid after the arena is gone, but are overwritten by the arena's next build.
+ * Laplacian levels are kept in laplacianDepth of the image's depth, CV_16S for a CV_8U image.
+ */
+class PyramidArena {
+public:
+    PyramidArena() {}
+
+    /**
+     * Build a gaussian pyramid, the same as createGaussianPyramid.
+     * The base level is input_image itself rather than a copy.
+     *
+     * @param input_image: The image that will make up the pyramid.
+     * @param level_number: The number of levels below the base, clamped to maxLevelNumber of its size.
+     */
+    void buildGaussian(const Mat& input_image, size_t level_number);
+
+    /**
+     * Build a laplacian pyramid straight from an image, the same as createGaussianPyramid
+     * followed by createLaplacianPyramid. Each gaussian level is blurred down, expanded
+     * back up and subtracted from in place while it is still in cache, in one sweep.
+     *
+     * @param input_image: The image that will make up the pyramid.
+     * @param level_number: The number of levels below the base, clamped to maxLevelNumber of its size.
+     */
+    void buildLaplacian(const Mat& input_image, size_t level_number);
+
+    /**
+     * Build a laplacian pyramid from an existing gaussian pyramid, the same as createLaplacianPyramid.
+     *
+     * @param gauss_pyramid: The gaussian pyramid, base level first.
+     */
+    void buildLaplacian(const vector<Mat>& gauss_pyramid);
+
+    /**
+     * The levels in the order the matching vector function gives them: base first for a
+     * gaussian pyramid, and smallest first for a laplacian one.
+     */
+    vector<Mat>& levels() { return levels_; }
+    const vector<Mat>& levels() const { return levels_; }
+
+    size_t size() const { return levels_.size(); }
+
+    /**
+     * The bytes held by the arena, levels and scratch space together.
+     */
+    size_t capacity() const { return storage_.total() * storage_.elemSize() + scratch_.total() * scratch_.elemSize(); }
+
+private:
+    /**
+     * Lay the levels out for a base size, reusing the block if it is big enough.
+     * Afterwards storage_levels_ holds the levels base first.
+     *
+     * @param laplacian: Store the base level and make the scratch row too. A gaussian
+     *                   pyramid needs neither, and leaves storage_levels_[0] empty.
+     */
+    void allocate(Size base, int type, size_t level_number, bool laplacian);
+
+    Mat storage_;
+    Mat scratch_;                   // the expanded level being subtracted, as one row
+    vector<Mat> storage_levels_;
+    vector<Mat> levels_;
+};
+
+#endif // __PyramidArena_h
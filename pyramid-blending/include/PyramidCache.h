@@ -0,0 +1,149 @@
+#ifndef __PyramidCache_h
+#define __PyramidCache_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       PyramidCache.h
+ *
+ *   @brief      Header file for PyramidCache.cxx to declare the on disk cache of laplacian pyramids
+ *
+ *   @date       11/02/21
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+using namespace cv;
+
+/*
+ * Each cached pyramid is one file, <key>.pyr in the cache directory:
+ *
+ *   header:  "CVPYRAM2", the key's hash, digest and source bytes, the Mat type, the number of levels
+ *   table:   rows, cols and byte offset of every level, smallest first
+ *   data:    each level's rows, continuous, starting on a 64 byte boundary
+ *
+ * all in the machine's own byte order. Files are written under a temporary name and
+ * renamed into place, so several processes or threads can share one directory.
+ */
+
+/**
+ * What a cached pyramid is found and checked by. The hash names the file. The digest, a
+ * second hash of the same bytes with its own seed and multiplier, and the number of bytes
+ * hashed are kept in the file's header, and a file whose header does not match all three is
+ * a miss, so two sources that only share the 64 bit hash never get each other's pyramid.
+ */
+struct PyramidKey {
+    PyramidKey() : hash(0), digest(0), source_bytes(0) {}
+
+    uint64 hash;
+    uint64 digest;
+    uint64 source_bytes;
+};
+
+/**
+ * A laplacian pyramid either mapped from the cache or built in memory. The levels are
+ * Mats onto the mapping, which is unmapped when the last copy of the CachedPyramid goes,
+ * so keep the CachedPyramid for as long as the levels are used. Mapped levels are copy on
+ * write: writing to one changes this process's copy and never the file.
+ */
+class CachedPyramid {
+public:
+    CachedPyramid() {}
+
+    /**
+     * The levels, smallest first as createLaplacianPyramid gives them.
+     */
+    vector<Mat>& levels() { return levels_; }
+    const vector<Mat>& levels() const { return levels_; }
+
+    bool empty() const { return levels_.empty(); }
+
+    /**
+     * Whether the levels came from the cache rather than being built.
+     */
+    bool mapped() const { return mapping_ != nullptr; }
+
+    void release() {
+        levels_.clear();
+        mapping_.reset();
+    }
+
+private:
+    friend bool loadCachedPyramid(const PyramidKey& key, CachedPyramid& pyramid);
+    friend void buildCachedPyramid(const Mat& image, size_t level_number, const PyramidKey& key,
+                                   CachedPyramid& pyramid);
+
+    shared_ptr<void> mapping_;
+    vector<Mat> levels_;
+};
+
+/**
+ * Start looking pyramids up in, and saving them to, a directory. It is created if missing.
+ * Until this is called the cache functions build every pyramid and save nothing.
+ *
+ * @param directory: The directory the pyramid files are kept in.
+ */
+void enablePyramidCache(const string& directory);
+
+/**
+ * Whether enablePyramidCache has been called.
+ */
+bool pyramidCacheEnabled();
+
+/**
+ * The key of an image's laplacian pyramid: hashes of its size, type and pixels, and the levels.
+ *
+ * @param image: The image the pyramid is made from.
+ * @param level_number: The number of levels below the base.
+ */
+PyramidKey pyramidKey(const Mat& image, size_t level_number);
+
+/**
+ * The key of the pyramid of an image file once decoded and converted to a type. Only the
+ * encoded bytes are hashed, so a hit skips decoding the image as well as building the pyramid.
+ *
+ * @param image_filename: The image file the pyramid is made from.
+ * @param type: The type the decoded image is converted to before building the pyramid.
+ * @param level_number: The number of levels below the base.
+ */
+PyramidKey pyramidKey(const string& image_filename, int type, size_t level_number);
+
+/**
+ * Map a pyramid from the cache, without copying its levels. The header is read and checked
+ * against the whole key first, and the file is only mapped if it matches.
+ *
+ * @param key: The pyramid's key.
+ * @param pyramid: Output, the mapped pyramid, left as it was on a miss.
+ * @return false if the cache is off, or has no valid pyramid for the key.
+ */
+bool loadCachedPyramid(const PyramidKey& key, CachedPyramid& pyramid);
+
+/**
+ * Build an image's laplacian pyramid, and save it to the cache under a key if the cache is on.
+ *
+ * @param image: The image that will make up the pyramid.
+ * @param level_number: The number of levels below the base.
+ * @param key: The key to save it under.
+ * @param pyramid: Output, the pyramid, held in memory rather than mapped.
+ */
+void buildCachedPyramid(const Mat& image, size_t level_number, const PyramidKey& key, CachedPyramid& pyramid);
+
+/**
+ * An image's laplacian pyramid, from the cache when it is there, otherwise built and saved.
+ * The same as PyramidArena::buildLaplacian when the cache is off.
+ *
+ * @param image: The image that will make up the pyramid.
+ * @param level_number: The number of levels below the base.
+ * @param pyramid: Output, the pyramid.
+ */
+void cachedLaplacianPyramid(const Mat& image, size_t level_number, CachedPyramid& pyramid);
+
+#endif // __PyramidCache_h
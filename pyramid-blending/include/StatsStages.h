@@ -0,0 +1,37 @@
+#ifndef __StatsStages_h
+#define __StatsStages_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       StatsStages.h
+ *
+ *   @brief      The stages of blending that Stats.h times, and the names they are written under
+ *
+ *   @date       11/02/21
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+/**
+ * The stages of blending that are timed. Each image read or written is one sample, so the
+ * imwrite rate is the image throughput.
+ */
+enum Stage {
+    STAGE_IMREAD,
+    STAGE_GAUSSIAN,
+    STAGE_LAPLACIAN,
+    STAGE_SWAP,
+    STAGE_RECONSTRUCT,
+    STAGE_BLEND,        // the whole of blend, pyramids and collapse together
+    STAGE_IMWRITE,
+    STAGE_COUNT
+};
+
+static const char* const STAGE_NAMES[STAGE_COUNT] = {
+    "imread", "gaussian", "laplacian", "swap", "reconstruct", "blend", "imwrite"
+};
+
+#endif // __StatsStages_h
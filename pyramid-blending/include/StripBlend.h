@@ -0,0 +1,64 @@
+#ifndef __StripBlend_h
+#define __StripBlend_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       StripBlend.h
+ *
+ *   @brief      Header file for StripBlend.cxx to declare blending images too large to hold whole
+ *
+ *   @date       11/02/21
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <string>
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+using namespace cv;
+
+/**
+ * The rows above and below a strip that it has to be blended with, so that its own rows
+ * come out the same as if the whole image had been blended at once. Each level the
+ * 5-tap pyrDown and pyrUp reach a little further, doubling with every level.
+ *
+ * @param level_number: The number of levels below the base.
+ */
+int64 stripHalo(size_t level_number);
+
+/**
+ * Blend two raw images through a raw mask a horizontal strip at a time, reading and
+ * writing rows as it goes. Only one window of rows, a strip plus its halo above and
+ * below, is held at once, so memory does not depend on the height of the image.
+ *
+ * The window is a full resolution block of strip_rows + 2 * stripHalo(level_number) rows,
+ * and every level of both pyramids is built over all of it, so memory grows with the width
+ * times 2^level_number: the 8 bit inputs, the float copies, the two laplacian arenas with
+ * their scratch rows, the mask's gaussian pyramid and the two collapse buffers come to about
+ * 115 bytes a pixel of the window on the float path and about 50 on the fixed point one.
+ * Each strip also blends its halos again, so every output row is blended about
+ * (strip_rows + 2 * halo) / strip_rows times, 3 times when the strip is as tall as the halo.
+ * Taller strips cost more memory and less repeated work.
+ *
+ * The images are headerless 8-bit BGR rows and the mask headerless 8-bit gray rows,
+ * white taking the first image. The output is written the same way as the images.
+ *
+ * @param image_1_filename: The first image.
+ * @param image_2_filename: The second image.
+ * @param mask_filename: The mask.
+ * @param output_filename: The file the blended rows are written to, - for stdout.
+ * @param size: The width and height of the images and mask.
+ * @param level_number: The number of levels below the base, clamped to maxLevelNumber of the size.
+ *                      When the halo is as tall as the image, the image is blended as one strip.
+ * @param strip_rows: The rows written per strip, rounded up to a multiple of 2^level_number,
+ *                    0 for strips as tall as the halo.
+ * @param fixed_point: Blend on the CV_8U/CV_16S path instead of converting the strips to CV_32F.
+ */
+void blendStrips(const string& image_1_filename, const string& image_2_filename, const string& mask_filename,
+                 const string& output_filename, Size size, size_t level_number, int strip_rows, bool fixed_point);
+
+#endif // __StripBlend_h
@@ -0,0 +1,113 @@
+#ifndef __WeightedBlend_h
+#define __WeightedBlend_h
+
+/**
+ ********************************************************************************
+ *
+ *   @file       WeightedBlend.h
+ *
+ *   @brief      Header file for WeightedBlend.cxx to declare multi-band blending any number of weighted images
+ *
+ *   @date       11/02/21
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <vector>
+#include <functional>
+#include <opencv2/opencv.hpp>
+
+#include "PyramidArena.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ * The running sums of a weighted multi-band blend. Each image added is broken into its
+ * laplacian pyramid and its weight map into a gaussian pyramid, and every level is added
+ * into one pyramid of weighted sums and one of summed weights, then thrown away. However
+ * many images are added, only those two pyramids and the arenas for the current image
+ * are held, so memory depends on the image size and not the number of images.
+ *
+ * Everything is summed in CV_32F, whatever the images' depth.
+ */
+class BlendAccumulator {
+public:
+    BlendAccumulator() : level_number_(0), count_(0) {}
+
+    /**
+     * @param level_number: The number of levels below the base.
+     */
+    explicit BlendAccumulator(size_t level_number) : level_number_(level_number), count_(0) {}
+
+    /**
+     * Add an image and its weights. The first image added sets the size and channels for the rest.
+     *
+     * @param image: The image, CV_8U or CV_32F, 0 to 255.
+     * @param weight: A single channel weight map the size of the image, CV_32F from 0 to 1 or CV_8U
+     *                from 0 to 255. The weights need not sum to 1, they are normalised per level.
+     */
+    void add(const Mat& image, const Mat& weight);
+
+    /**
+     * Add the sums of another accumulator, built with the same level number from images of the
+     * same size, as if its images had been added to this one.
+     *
+     * @param other: The accumulator to add in.
+     */
+    void merge(const BlendAccumulator& other);
+
+    /**
+     * Divide every level of weighted sums by its summed weights and collapse the result.
+     * Pixels with no weight at all are black.
+     *
+     * @return The blended image, CV_32F with the images' channels.
+     */
+    Mat result() const;
+
+    /**
+     * The number of images added, merged ones included.
+     */
+    size_t count() const { return count_; }
+
+private:
+    size_t level_number_;
+    size_t count_;
+    vector<Mat> sum_;           // the weighted laplacian levels, smallest first
+    vector<Mat> weight_sum_;    // the summed gaussian weight levels, smallest first
+    PyramidArena image_arena_;
+    PyramidArena weight_arena_;
+    Mat image_float_;
+    Mat weight_float_;
+};
+
+/**
+ * Multi-band blend any number of images, each through its own weight map, loading one image
+ * at a time per thread. Each thread adds its images into its own BlendAccumulator, and those
+ * are merged once every image is in, so memory grows with the threads and not the images.
+ * With more than one thread the order the sums are added in varies between runs, so results
+ * can differ in the last bits of the float.
+ *
+ * @param image_count: The number of images.
+ * @param load: Called with an index and fills in that image and its weight map, as for
+ *              BlendAccumulator::add. Called from several threads at once when threads is not 1.
+ * @param level_number: The number of levels below the base.
+ * @param threads: The number of threads adding images, 0 for one per core.
+ * @return The blended image, CV_32F with the images' channels.
+ */
+Mat blendWeighted(size_t image_count, const function<void(size_t, Mat&, Mat&)>& load, size_t level_number,
+                  size_t threads = 1);
+
+/**
+ * The same, for images already loaded.
+ *
+ * @param images: The images, CV_8U or CV_32F, all the same size.
+ * @param weights: One weight map per image.
+ * @param level_number: The number of levels below the base.
+ * @param threads: The number of threads adding images, 0 for one per core.
+ */
+Mat blendWeighted(const vector<Mat>& images, const vector<Mat>& weights, size_t level_number, size_t threads = 1);
+
+#endif // __WeightedBlend_h
@@ -0,0 +1,326 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       BatchBlend.cxx
+ *
+ *   @brief      Handle blending a manifest of image pairs, overlapping reading, blending and writing
+ *
+ *   @date       11/02/21
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include "BatchBlend.h"
+#include "BoundedQueue.h"
+#include "Pyramid.h"
+#include "PyramidCache.h"
+#include "Stats.h"
+
+/**
+ * One line of the manifest, and the images it moves through the pipeline with.
+ * Only the thread holding its index touches it, the queues pass it on.
+ */
+struct BatchJob {
+    size_t line;
+    string image_1_filename;
+    string image_2_filename;
+    string mask_filename;
+    string output_filename;
+    size_t level_number;
+
+    Mat image_1;
+    Mat image_2;
+    PyramidKey key_1;
+    PyramidKey key_2;
+    CachedPyramid pyramid_1;
+    CachedPyramid pyramid_2;
+    Mat mask;
+    Mat result;
+    string error;
+};
+
+/**
+ * Everything the reading, blending and writing threads share.
+ */
+struct BatchState {
+    BatchState(vector<BatchJob>& jobs, const string& manifest_filename, size_t workers, bool fixed_point)
+        : jobs(jobs), manifest_filename(manifest_filename), fixed_point(fixed_point),
+          loaded(workers), finished(workers), next_job(0), failed(0), reused(0) {}
+
+    vector<BatchJob>& jobs;
+    const string& manifest_filename;
+    bool fixed_point;
+
+    // one job queued ahead of each worker each side, so no more images than that are held at once
+    BoundedQueue<size_t> loaded;
+    BoundedQueue<size_t> finished;
+
+    atomic<size_t> next_job;
+    atomic<size_t> failed;
+    atomic<size_t> reused;      // pyramids mapped from the cache instead of decoded and built
+};
+
+static vector<BatchJob> readManifest(const string& manifest_filename, size_t level_number) {
+    ifstream manifest(manifest_filename.c_str());
+
+    if (!manifest) {
+        string error_message;
+        error_message  = "Could not open or find the manifest \"";
+        error_message += manifest_filename;
+        error_message += "\".";
+
+        throw error_message;
+    }
+
+    vector<BatchJob> jobs;
+    string text;
+
+    for (size_t line = 1; getline(manifest, text); ++line) {
+        istringstream fields(text);
+        BatchJob job;
+        job.line = line;
+        job.level_number = level_number;
+
+        if (!(fields >> job.image_1_filename) || job.image_1_filename[0] == '#') {
+            continue;
+        }
+
+        string levels;
+        string extra;
+        bool complete = (bool) (fields >> job.image_2_filename >> job.mask_filename >> job.output_filename);
+
+        if (complete && fields >> levels) {
+            int value = atoi(levels.c_str());
+            complete = value >= 0 && levels.find_first_not_of("0123456789") == string::npos;
+            job.level_number = value;
+        }
+
+        if (!complete || fields >> extra) {
+            stringstream error_message;
+            error_message << manifest_filename << ":" << line
+                          << ": expected <image_1> <image_2> <mask/-> <output> [levels]";
+
+            throw error_message.str();
+        }
+
+        jobs.push_back(job);
+    }
+
+    return jobs;
+}
+
+static Mat readImage(const string& filename, int flags, const char* what) {
+    Mat image;
+    {
+        ScopedTimer timer(STAGE_IMREAD);
+        image = imread(filename, flags);
+    }
+
+    if (!image.data) {
+        string error_message;
+        error_message  = "Could not open or find the ";
+        error_message += what;
+        error_message += " \"";
+        error_message += filename;
+        error_message += "\".";
+
+        throw error_message;
+    }
+
+    return image;
+}
+
+// a pyramid in the cache is mapped in place of its image, otherwise the image is decoded
+static void readImageOrPyramid(BatchState& state, const string& filename, size_t level_number, const char* what,
+                               PyramidKey& key, CachedPyramid& pyramid, Mat& image) {
+    if (pyramidCacheEnabled()) {
+        key = pyramidKey(filename, state.fixed_point ? CV_8UC3 : CV_32FC3, level_number);
+
+        if (loadCachedPyramid(key, pyramid)) {
+            ++state.reused;
+            return;
+        }
+    }
+
+    image = readImage(filename, IMREAD_COLOR, what);
+}
+
+// decode each job's images, passing failures straight on to be reported
+static void readJobs(BatchState& state) {
+    for (size_t i = state.next_job++; i < state.jobs.size(); i = state.next_job++) {
+        BatchJob& job = state.jobs[i];
+
+        try {
+            readImageOrPyramid(state, job.image_1_filename, job.level_number, "first image",
+                               job.key_1, job.pyramid_1, job.image_1);
+            readImageOrPyramid(state, job.image_2_filename, job.level_number, "second image",
+                               job.key_2, job.pyramid_2, job.image_2);
+
+            if (job.mask_filename != "-") {
+                job.mask = readImage(job.mask_filename, IMREAD_GRAYSCALE, "mask");
+            }
+        } catch (const string& error) {
+            job.error = error;
+        } catch (const exception& error) {
+            job.error = error.what();
+        }
+
+        if (job.error.empty()) {
+            state.loaded.push(i);
+        } else {
+            state.finished.push(i);
+        }
+    }
+}
+
+// build a pyramid the reader could not map, saving it to the cache under its file's key
+static void buildPyramid(BatchState& state, Mat& image, size_t level_number, const PyramidKey& key,
+                         CachedPyramid& pyramid) {
+    if (pyramid.empty()) {
+        if (!state.fixed_point) {
+            image.convertTo(image, CV_32FC3);
+        }
+
+        buildCachedPyramid(image, level_number, key, pyramid);
+    }
+}
+
+static void blendJobs(BatchState& state) {
+    size_t i;
+
+    while (state.loaded.pop(i)) {
+        BatchJob& job = state.jobs[i];
+
+        try {
+            ScopedTimer timer(STAGE_BLEND);
+            buildPyramid(state, job.image_1, job.level_number, job.key_1, job.pyramid_1);
+            buildPyramid(state, job.image_2, job.level_number, job.key_2, job.pyramid_2);
+
+            // a mask of - is a hard split down the middle, blended across the seam like any other mask.
+            // Unlike the interactive mode's swapHalves, which cuts every laplacian level, it leaves no hard edge
+            if (job.mask.empty()) {
+                job.mask = Mat::zeros(job.pyramid_1.levels().back().size(), CV_8UC1);
+                job.mask.colRange(0, job.mask.cols / 2).setTo(Scalar::all(255));
+            }
+
+            job.result = blend(job.pyramid_1.levels(), job.pyramid_2.levels(), job.mask);
+        } catch (const string& error) {
+            job.error = error;
+        } catch (const exception& error) {
+            job.error = error.what();
+        }
+
+        // the inputs are done with, so only the result waits in the write queue
+        job.image_1.release();
+        job.image_2.release();
+        job.pyramid_1.release();
+        job.pyramid_2.release();
+        job.mask.release();
+
+        state.finished.push(i);
+    }
+}
+
+static void writeJobs(BatchState& state) {
+    size_t i;
+
+    while (state.finished.pop(i)) {
+        BatchJob& job = state.jobs[i];
+
+        if (job.error.empty()) {
+            try {
+                job.result.convertTo(job.result, CV_8UC3);
+
+                ScopedTimer timer(STAGE_IMWRITE);
+                if (!imwrite(job.output_filename, job.result)) {
+                    job.error = "Could not write \"" + job.output_filename + "\".";
+                }
+            } catch (const exception& error) {
+                job.error = error.what();
+            }
+        }
+        job.result.release();
+
+        if (!job.error.empty()) {
+            ++state.failed;
+
+            stringstream message;
+            message << state.manifest_filename << ":" << job.line << ": " << job.error << "\n";
+            cerr << message.str();
+        }
+    }
+}
+
+size_t runBatch(const string& manifest_filename, size_t level_number, size_t workers, size_t io_threads,
+                bool fixed_point) {
+    vector<BatchJob> jobs = readManifest(manifest_filename, level_number);
+
+    if (workers == 0) {
+        workers = thread::hardware_concurrency();
+    }
+    workers = max<size_t>(workers, 1);
+    io_threads = max<size_t>(io_threads, 1);
+
+    // the workers already keep every core busy with whole jobs, so OpenCV's own
+    // threads inside pyrDown and pyrUp would only compete with them
+    int opencv_threads = getNumThreads();
+    if (workers > 1) {
+        setNumThreads(1);
+    }
+
+    BatchState state(jobs, manifest_filename, workers, fixed_point);
+
+    cerr << "blending " << jobs.size() << " jobs on " << workers << " workers with "
+         << io_threads << " reading and " << io_threads << " writing" << endl;
+
+    int64 start = getTickCount();
+
+    vector<thread> readers;
+    vector<thread> blenders;
+    vector<thread> writers;
+    for (size_t i = 0; i < io_threads; ++i) {
+        readers.push_back(thread(readJobs, ref(state)));
+        writers.push_back(thread(writeJobs, ref(state)));
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        blenders.push_back(thread(blendJobs, ref(state)));
+    }
+
+    // each stage is closed once everything feeding it has finished, which lets the next one drain and stop
+    for (size_t i = 0; i < readers.size(); ++i) {
+        readers[i].join();
+    }
+    state.loaded.close();
+
+    for (size_t i = 0; i < blenders.size(); ++i) {
+        blenders[i].join();
+    }
+    state.finished.close();
+
+    for (size_t i = 0; i < writers.size(); ++i) {
+        writers[i].join();
+    }
+
+    double seconds = (getTickCount() - start) / getTickFrequency();
+    setNumThreads(opencv_threads);
+
+    size_t failed = state.failed;
+    cout << jobs.size() - failed << " of " << jobs.size() << " jobs blended in " << seconds << "s ("
+         << (seconds > 0 ? jobs.size() / seconds : 0) << " jobs/s)";
+    if (pyramidCacheEnabled()) {
+        cout << ", " << state.reused.load() << " pyramids reused from the cache";
+    }
+    cout << endl;
+
+    return failed;
+}
@@ -0,0 +1,192 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       Benchmark.cxx
+ *
+ *   @brief      Times the Pyramid.h functions on synthetic gradient images
+ *
+ *   @date       11/02/21
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <exception>
+
+#include "Pyramid.h"
+#include "PyramidArena.h"
+#include "WeightedBlend.h"
+#include "BenchmarkHarness.h"
+
+// the same as Blending, which the pyramids now manage at any size
+static const size_t LEVELS = 8;
+
+/**
+ * A 3 channel CV_32F image of crossing gradients and ripples, the same on every run.
+ *
+ * @param size: The size of the image.
+ * @param phase: Shifts the pattern, so two images can differ.
+ */
+static Mat syntheticImage(Size size, float phase) {
+    Mat image(size, CV_32FC3);
+
+    for (int y = 0; y < size.height; y++) {
+        float* row = image.ptr<float>(y);
+        float v = (float) y / size.height;
+
+        for (int x = 0; x < size.width; x++) {
+            float u = (float) x / size.width;
+            float ripple = 32 * sin(40 * (u + v) + phase);
+
+            row[3 * x] = 255 * u;
+            row[3 * x + 1] = 255 * v;
+            row[3 * x + 2] = 128 + ripple;
+        }
+    }
+
+    return image;
+}
+
+int main(int argc, char** argv) {
+    try {
+        BenchmarkOptions options = parseBenchmarkOptions(argc, argv);
+        vector<BenchmarkSize> sizes = benchmarkSizes(options);
+        BenchmarkRunner runner(options);
+
+        for (size_t s = 0; s < sizes.size(); s++) {
+            const BenchmarkSize& size = sizes[s];
+            size_t levels = LEVELS;
+
+            Mat image_1 = syntheticImage(size.size, 0);
+            Mat image_2 = syntheticImage(size.size, 1.5f);
+
+            // the inputs are built outside the timed runs, so each run has them even when
+            // -filter skips the run that would otherwise have made them
+            vector<Mat> gauss_input;
+            vector<Mat> lapl_input;
+            createGaussianPyramid(image_1, gauss_input, levels);
+            createLaplacianPyramid(gauss_input, lapl_input);
+
+            vector<Mat> gauss_pyramid;
+            vector<Mat> lapl_pyramid;
+
+            runner.run("createGaussianPyramid/" + size.name, [&]() {
+                createGaussianPyramid(image_1, gauss_pyramid, levels);
+            });
+
+            runner.run("createLaplacianPyramid/" + size.name, [&]() {
+                createLaplacianPyramid(gauss_input, lapl_pyramid);
+            });
+
+            // the fused sweep into an arena that is reused between runs
+            PyramidArena arena;
+            runner.run("PyramidArena::buildLaplacian/" + size.name, [&]() {
+                arena.buildLaplacian(image_1, levels);
+            });
+
+            runner.run("reconstruct/" + size.name, [&]() {
+                reconstruct(lapl_input, 0);
+            });
+
+            vector<Mat> reconstructions;
+            runner.run("reconstructLevels/" + size.name, [&]() {
+                reconstructLevels(lapl_input, reconstructions);
+            });
+
+            runner.run("reconstructPreview/" + size.name, [&]() {
+                reconstructPreview(lapl_input, 320);
+            });
+
+            // a soft diagonal seam, so every level has a real mix of both images
+            Mat mask(size.size, CV_32F);
+            for (int y = 0; y < mask.rows; y++) {
+                float* row = mask.ptr<float>(y);
+                for (int x = 0; x < mask.cols; x++) {
+                    row[x] = min(1.0f, max(0.0f, 0.5f + (float) (x - y) / mask.cols));
+                }
+            }
+
+            runner.run("blend/" + size.name, [&]() {
+                blend(image_1, image_2, mask, levels);
+            });
+
+            // four images, each weighted by an overlapping vertical band, the way a mosaic's are
+            vector<Mat> images;
+            vector<Mat> weights;
+            for (int i = 0; i < 4; i++) {
+                Mat weight(size.size, CV_32F);
+                float centre = (i + 0.5f) / 4;
+
+                for (int y = 0; y < weight.rows; y++) {
+                    float* row = weight.ptr<float>(y);
+                    for (int x = 0; x < weight.cols; x++) {
+                        row[x] = max(0.0f, 1 - 4 * fabs((float) x / weight.cols - centre));
+                    }
+                }
+
+                images.push_back(syntheticImage(size.size, 0.75f * i));
+                weights.push_back(weight);
+            }
+
+            runner.run("blendWeighted/4/" + size.name, [&]() {
+                blendWeighted(images, weights, levels);
+            });
+
+            runner.run("blendWeighted/4/threads/" + size.name, [&]() {
+                blendWeighted(images, weights, levels, 0);
+            });
+
+            // the fixed point path, on the same images rounded to 8 bits
+            Mat image_1_fixed, image_2_fixed, mask_fixed;
+            image_1.convertTo(image_1_fixed, CV_8UC3);
+            image_2.convertTo(image_2_fixed, CV_8UC3);
+            mask.convertTo(mask_fixed, CV_8U, 255);
+
+            vector<Mat> gauss_input_fixed;
+            vector<Mat> lapl_input_fixed;
+            createGaussianPyramid(image_1_fixed, gauss_input_fixed, levels);
+            createLaplacianPyramid(gauss_input_fixed, lapl_input_fixed);
+
+            runner.run("createGaussianPyramid/fixed/" + size.name, [&]() {
+                createGaussianPyramid(image_1_fixed, gauss_pyramid, levels);
+            });
+
+            runner.run("createLaplacianPyramid/fixed/" + size.name, [&]() {
+                createLaplacianPyramid(gauss_input_fixed, lapl_pyramid);
+            });
+
+            runner.run("PyramidArena::buildLaplacian/fixed/" + size.name, [&]() {
+                arena.buildLaplacian(image_1_fixed, levels);
+            });
+
+            runner.run("reconstruct/fixed/" + size.name, [&]() {
+                reconstruct(lapl_input_fixed, 0);
+            });
+
+            runner.run("blend/fixed/" + size.name, [&]() {
+                blend(image_1_fixed, image_2_fixed, mask_fixed, levels);
+            });
+
+            runner.run("swapHalves/" + size.name, [&]() {
+                swapHalves(image_1, image_2);
+            });
+        }
+
+        return runner.finish();
+    } catch (const exception& error) {
+        // Display an error message in the console
+        cerr << error.what() << endl;
+    } catch (const string& error) {
+        // Display an error message in the console
+        cerr << error << endl;
+    } catch (...) {
+        // Display an error message in the console
+        cerr << "Unnown error caught" << endl;
+    }
+
+    return 1;
+}
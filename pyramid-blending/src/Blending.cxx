@@ -14,7 +14,74 @@
  ********************************************************************************
  */
 
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+
 #include "Pyramid.h"
+#include "PyramidArena.h"
+#include "StripBlend.h"
+#include "BatchBlend.h"
+#include "PyramidCache.h"
+#include "WeightedBlend.h"
+#include "Stats.h"
+
+/**
+ * Every form the command line takes.
+ *
+ * @param program: argv[0].
+ */
+static string usage(const char* program) {
+    string usage;
+    usage  = "usage: ";
+    usage += program;
+    usage += " [-display] <image_1> [-display]";
+    usage += " <image_2> [-display]";
+    usage += " [-mask <mask_image>] [-levels <n>]";
+    usage += "\n       ";
+    usage += program;
+    usage += " -stream <width>x<height> [-levels <n>] [-strip <rows>]";
+    usage += " <image_1.raw> <image_2.raw> <mask.raw> <output.raw/->";
+    usage += "\n       ";
+    usage += program;
+    usage += " -batch <manifest.txt> [-levels <n>] [-workers <n>] [-io-threads <n>]";
+    usage += "\n       ";
+    usage += program;
+    usage += " -weighted <output> [-levels <n>] [-workers <n>]";
+    usage += " <image_1> <weights_1> [<image_2> <weights_2> ...]\n";
+    usage += "Any form accepts [-stats <file.json/file.csv> [-stats-every <seconds>]]";
+    usage += "\nAll but the -weighted form accept [-fixed-point]";
+    usage += "\nThe -mask and -batch forms accept [-cache <directory>]";
+    
+    return usage;
+}
+
+/**
+ * Read the value of a flag that counts something, which must be a whole number from 1 up.
+ *
+ * @param flag: The flag, for the error message.
+ * @param text: The value given.
+ * @param program: argv[0], for the usage message.
+ */
+static size_t parseCount(const string& flag, const char* text, const char* program) {
+    char* end;
+    errno = 0;
+    long value = strtol(text, &end, 10);
+    
+    if (end == text || *end != '\0' || errno != 0 || value < 1 || value > INT_MAX) {
+        string error_message;
+        error_message  = flag;
+        error_message += " takes a whole number of at least 1, not \"";
+        error_message += text;
+        error_message += "\"\n";
+        error_message += usage(program);
+        
+        throw error_message;
+    }
+    
+    return (size_t) value;
+}
 
 int main (int argc, char** argv) {
     try {
@@ -26,24 +93,160 @@ int main (int argc, char** argv) {
         Mat image_2;
         string window_title; // the generated window title
         bool testing = true;
+        string stats_filename;
+        double stats_interval = 0;
+        string mask_filename;
+        Size stream_size;
+        size_t level_number = 8;
+        int strip_rows = 0;
+        bool fixed_point = false;
+        string manifest_filename;
+        size_t workers = 0;
+        size_t io_threads = 2;
+        string cache_directory;
+        string weighted_filename;
+        
+        // the stats, mask, stream and batch flags can go anywhere, the rest are positional
+        vector<string> args;
+        for (int i = 0; i < argc; i++) {
+            string temp = argv[i];
+            
+            if (temp == "-stats" && i + 1 < argc) {
+                stats_filename = argv[++i];
+            } else if (temp == "-stats-every" && i + 1 < argc) {
+                stats_interval = atof(argv[++i]);
+            } else if (temp == "-mask" && i + 1 < argc) {
+                mask_filename = argv[++i];
+            } else if (temp == "-stream" && i + 1 < argc) {
+                if (sscanf(argv[++i], "%dx%d", &stream_size.width, &stream_size.height) != 2 ||
+                    stream_size.width <= 0 || stream_size.height <= 0) {
+                    throw string("-stream takes the size of the images as <width>x<height>");
+                }
+            } else if (temp == "-levels" && i + 1 < argc) {
+                level_number = parseCount(temp, argv[++i], argv[0]);
+            } else if (temp == "-fixed-point") {
+                fixed_point = true;
+            } else if (temp == "-strip" && i + 1 < argc) {
+                strip_rows = atoi(argv[++i]);
+            } else if (temp == "-batch" && i + 1 < argc) {
+                manifest_filename = argv[++i];
+            } else if (temp == "-workers" && i + 1 < argc) {
+                workers = parseCount(temp, argv[++i], argv[0]);
+            } else if (temp == "-io-threads" && i + 1 < argc) {
+                io_threads = parseCount(temp, argv[++i], argv[0]);
+            } else if (temp == "-cache" && i + 1 < argc) {
+                cache_directory = argv[++i];
+            } else if (temp == "-weighted" && i + 1 < argc) {
+                weighted_filename = argv[++i];
+            } else {
+                args.push_back(temp);
+            }
+        }
+        
+        if (!stats_filename.empty()) {
+            enableStats(stats_filename, stats_interval);
+        }
+        
+        // strips are never blended twice, so only the mask and batch modes look pyramids up
+        if (!cache_directory.empty() && stream_size.area() == 0) {
+            enablePyramidCache(cache_directory);
+        }
         
-        if (argc == 3 || argc == 4) {
-            filename_1 = argv[1];
-            filename_2 = argv[2];
-            for (int i = 0; i < argc; i++) {
-                string temp = argv[i];
+        if (!manifest_filename.empty()) {
+            if (args.size() != 1) {
+                string error_message;
+                error_message  = "usage: ";
+                error_message += argv[0];
+                error_message += " -batch <manifest.txt> [-levels <n>] [-workers <n>] [-io-threads <n>]";
+                
+                throw error_message;
+            }
+            
+            return runBatch(manifest_filename, level_number, workers, io_threads, fixed_point) ? 1 : 0;
+        }
+        
+        if (!weighted_filename.empty()) {
+            // BlendAccumulator always sums in CV_32F, so there is no fixed point path to take
+            if (args.size() < 3 || args.size() % 2 == 0 || fixed_point) {
+                string error_message;
+                error_message  = "usage: ";
+                error_message += argv[0];
+                error_message += " -weighted <output> [-levels <n>] [-workers <n>]";
+                error_message += " <image_1> <weights_1> [<image_2> <weights_2> ...]";
+                if (fixed_point) {
+                    error_message += "\n-weighted always blends in float and does not accept -fixed-point";
+                }
+                
+                throw error_message;
+            }
+            
+            // each image is read when a thread is ready for it, so only one per thread is held
+            Mat blended;
+            {
+                ScopedTimer timer(STAGE_BLEND);
+                blended = blendWeighted(args.size() / 2, [&](size_t i, Mat& image, Mat& weight) {
+                    {
+                        ScopedTimer timer(STAGE_IMREAD);
+                        image = imread(args[1 + 2 * i], IMREAD_COLOR);
+                        weight = imread(args[2 + 2 * i], IMREAD_GRAYSCALE);
+                    }
+                    
+                    if (!image.data || !weight.data) {
+                        string error_message;
+                        error_message  = "Could not open or find \"";
+                        error_message += args[image.data ? 2 + 2 * i : 1 + 2 * i];
+                        error_message += "\".";
+                        
+                        throw error_message;
+                    }
+                }, level_number, workers);
+            }
+            blended.convertTo(blended, CV_8UC3);
+            
+            {
+                ScopedTimer timer(STAGE_IMWRITE);
+                if (!imwrite(weighted_filename, blended)) {
+                    throw string("Could not write \"" + weighted_filename + "\".");
+                }
+            }
+            
+            return 0;
+        }
+        
+        if (stream_size.area() > 0) {
+            if (args.size() != 5) {
+                string error_message;
+                error_message  = "usage: ";
+                error_message += argv[0];
+                error_message += " -stream <width>x<height> [-levels <n>] [-strip <rows>]";
+                error_message += " <image_1.raw> <image_2.raw> <mask.raw> <output.raw/->";
+                
+                throw error_message;
+            }
+            
+            // 0 uses strips as tall as the halo: a window of 3 halos, each row blended about 3 times
+            blendStrips(args[1], args[2], args[3], args[4], stream_size, level_number, strip_rows, fixed_point);
+            
+            return 0;
+        }
+        
+        if (args.size() == 3 || args.size() == 4) {
+            filename_1 = args[1];
+            filename_2 = args[2];
+            for (size_t i = 0; i < args.size(); i++) {
+                string temp = args[i];
                 
                 if (temp == "-display") {
                     switch (i) {
                         case 1:
                             display_img_1 = true;
                             display_img_2 = true;
-                            filename_1 = argv[2];
-                            filename_2 = argv[3];
+                            filename_1 = args[2];
+                            filename_2 = args[3];
                             break;
                         case 2:
                             display_img_1 = true;
-                            filename_2 = argv[3];
+                            filename_2 = args[3];
                             break;
                         case 3:
                             display_img_2 = true;
@@ -63,8 +266,14 @@ int main (int argc, char** argv) {
             }
             
             // Load images
-            image_1 = imread(filename_1, IMREAD_COLOR);
-            image_2 = imread(filename_2, IMREAD_COLOR);
+            {
+                ScopedTimer timer(STAGE_IMREAD);
+                image_1 = imread(filename_1, IMREAD_COLOR);
+            }
+            {
+                ScopedTimer timer(STAGE_IMREAD);
+                image_2 = imread(filename_2, IMREAD_COLOR);
+            }
             
             // Check images loaded
             if (!image_1.data) {
@@ -86,24 +295,6 @@ int main (int argc, char** argv) {
                 throw error_message;
             }
             
-            // Are the image sizes powers of two?
-            if (!isPowerOfTwo((int)image_1.rows) || !isPowerOfTwo((int)image_1.cols)) {
-                int row_delta = image_2.rows - image_1.rows;
-                int col_delta = image_2.cols - image_1.cols;
-                
-                // Add a border on both edges - keeps image central.
-                // May make image +/- 1px due to using integers, which screws up pyramid creation(?or something else).
-                // copyMakeBorder(image_1, image_1, row_delta / 2, row_delta / 2, col_delta / 2, col_delta / 2, BORDER_REPLICATE);
-                copyMakeBorder(image_1, image_1, row_delta, 0, col_delta, 0, BORDER_DEFAULT);
-                
-            }
-            if (!isPowerOfTwo((int)image_2.rows) || !isPowerOfTwo((int)image_2.cols)) {
-                int row_delta = image_1.rows - image_2.rows;
-                int col_delta = image_1.cols - image_2.cols;
-                
-                copyMakeBorder(image_2, image_2, row_delta, 0, col_delta, 0, BORDER_DEFAULT);
-            }
-            
             if (display_img_1) {
                 window_title = "Displaying: " +  filename_1 + "\"";
                 namedWindow(window_title, WINDOW_AUTOSIZE);
@@ -119,19 +310,77 @@ int main (int argc, char** argv) {
             //            destroyAllWindows();
             
             // convert both images to use 3 channel 32bit floats
-            image_1.convertTo(image_1, CV_32FC3);
-            image_2.convertTo(image_2, CV_32FC3);
+            // or keep them as CV_8UC3 for the fixed point path, with CV_16S laplacians
+            if (!fixed_point) {
+                image_1.convertTo(image_1, CV_32FC3);
+                image_2.convertTo(image_2, CV_32FC3);
+            }
             
-            if (image_1.rows == image_2.rows || image_1.cols == image_2.cols) {
-                size_t levels = 8;
+            // blend through a mask instead of swapping halves
+            if (!mask_filename.empty()) {
+                Mat mask;
+                {
+                    ScopedTimer timer(STAGE_IMREAD);
+                    mask = imread(mask_filename, IMREAD_GRAYSCALE);
+                }
+                
+                if (!mask.data) {
+                    string error_message;
+                    error_message  = "Could not open or find the mask \"";
+                    error_message += mask_filename;
+                    error_message += "\".";
+                    
+                    throw error_message;
+                }
+                
+                Mat blended;
+                {
+                    ScopedTimer timer(STAGE_BLEND);
+                    CachedPyramid lapl_pyramid_1;
+                    CachedPyramid lapl_pyramid_2;
+                    cachedLaplacianPyramid(image_1, level_number, lapl_pyramid_1);
+                    cachedLaplacianPyramid(image_2, level_number, lapl_pyramid_2);
+                    
+                    blended = blend(lapl_pyramid_1.levels(), lapl_pyramid_2.levels(), mask);
+                }
+                blended.convertTo(blended, CV_8UC3);
+                
+                window_title = "Displaying: \"" + filename_1 + "\" blended with \"" + filename_2 + "\"";
+                namedWindow(window_title, WINDOW_AUTOSIZE);
+                imshow(window_title, blended);
+                {
+                    ScopedTimer timer(STAGE_IMWRITE);
+                    imwrite("../blend.png", blended);
+                }
+                waitKey(0);
+                
+                return 0;
+            }
+            
+            // the pyramids take any size, but the two have to match to swap halves
+            if (image_1.size() == image_2.size()) {
+                size_t levels = level_number;
                 vector<Mat> gauss_pyramid_1;
                 vector<Mat> gauss_pyramid_2;
-                vector<Mat> lapl_pyramid_1;
-                vector<Mat> lapl_pyramid_2;
-                createGaussianPyramid(image_1, gauss_pyramid_1, levels);
-                createGaussianPyramid(image_2, gauss_pyramid_2, levels);
-                createLaplacianPyramid(gauss_pyramid_1, lapl_pyramid_1);
-                createLaplacianPyramid(gauss_pyramid_2, lapl_pyramid_2);
+                PyramidArena arena_1;
+                PyramidArena arena_2;
+                
+                // the laplacian pyramids are built straight from the images, so these are only for display
+                if (testing) {
+                    ScopedTimer timer(STAGE_GAUSSIAN);
+                    createGaussianPyramid(image_1, gauss_pyramid_1, levels);
+                    createGaussianPyramid(image_2, gauss_pyramid_2, levels);
+                }
+                {
+                    ScopedTimer timer(STAGE_LAPLACIAN);
+                    arena_1.buildLaplacian(image_1, levels);
+                }
+                {
+                    ScopedTimer timer(STAGE_LAPLACIAN);
+                    arena_2.buildLaplacian(image_2, levels);
+                }
+                vector<Mat>& lapl_pyramid_1 = arena_1.levels();
+                vector<Mat>& lapl_pyramid_2 = arena_2.levels();
                 
                 
                 
@@ -161,22 +410,39 @@ int main (int argc, char** argv) {
                     waitKey(0);
                 }
                 
-                for (size_t i = 0; i < lapl_pyramid_1.size(); ++i) {
-                    swapHalves(lapl_pyramid_1[i], lapl_pyramid_2[i]);
+                {
+                    ScopedTimer timer(STAGE_SWAP);
+                    for (size_t i = 0; i < lapl_pyramid_1.size(); ++i) {
+                        swapHalves(lapl_pyramid_1[i], lapl_pyramid_2[i]);
+                    }
                 }
                 
                 Mat lapl_pyramid_1_2 = visualisePyramid(lapl_pyramid_1);
                 Mat lapl_pyramid_2_1 = visualisePyramid(lapl_pyramid_2);
-                Mat recon_1 = reconstruct(lapl_pyramid_1, 1);
-                Mat recon_2 = reconstruct(lapl_pyramid_2, 1);
+                Mat recon_1;
+                Mat recon_2;
+                {
+                    ScopedTimer timer(STAGE_RECONSTRUCT);
+                    recon_1 = reconstruct(lapl_pyramid_1, 1);
+                }
+                {
+                    ScopedTimer timer(STAGE_RECONSTRUCT);
+                    recon_2 = reconstruct(lapl_pyramid_2, 1);
+                }
                 recon_1.convertTo(recon_1, CV_8UC3);
                 recon_2.convertTo(recon_2, CV_8UC3);
                 
                 // save & display for testing
                 if (testing) {
+                    // one collapse each gives every level, rather than one collapse per level
+                    vector<Mat> reconstructions_1;
+                    vector<Mat> reconstructions_2;
+                    reconstructLevels(lapl_pyramid_1, reconstructions_1);
+                    reconstructLevels(lapl_pyramid_2, reconstructions_2);
+                    
                     for (size_t i = 0; i < levels; ++i) {
-                        Mat reconstruct_1 = reconstruct(lapl_pyramid_1, i);
-                        Mat reconstruct_2 = reconstruct(lapl_pyramid_2, i);
+                        Mat reconstruct_1 = reconstructions_1[reconstructions_1.size() - 1 - i];
+                        Mat reconstruct_2 = reconstructions_2[reconstructions_2.size() - 1 - i];
                         reconstruct_1.convertTo(reconstruct_1, CV_8UC3);
                         reconstruct_2.convertTo(reconstruct_2, CV_8UC3);
                         
@@ -211,27 +477,27 @@ int main (int argc, char** argv) {
                 window_title = "Displaying: \"" + filename_1 + "\" split with \"" + filename_2 + "\"";
                 namedWindow(window_title, WINDOW_AUTOSIZE);
                 imshow(window_title, recon_1);
-                imwrite("../stitch-1-2.png", recon_1);
+                {
+                    ScopedTimer timer(STAGE_IMWRITE);
+                    imwrite("../stitch-1-2.png", recon_1);
+                }
                 
                 window_title = "Displaying: \"" + filename_2 + "\" split with \"" + filename_1 + "\"";
                 namedWindow(window_title, WINDOW_AUTOSIZE);
                 imshow(window_title, recon_2);
-                imwrite("../stitch-2-1.png", recon_2);
+                {
+                    ScopedTimer timer(STAGE_IMWRITE);
+                    imwrite("../stitch-2-1.png", recon_2);
+                }
                 waitKey(0);
             } else {
                 string error_message;
-                error_message = "Images are not the same size. Resizing failed\nAborting";
+                error_message = "Images are not the same size\nAborting";
                 
                 throw error_message;
             }
         } else {
-            string error_message;
-            error_message  = "usage: ";
-            error_message += argv[0];
-            error_message += " [-display] <image_1> [-display]";
-            error_message += " <image_2> [-display]";
-            
-            throw error_message;
+            throw usage(argv[0]);
         }
     } catch (const exception& error) {
         // Display an error message in the console
@@ -15,61 +15,245 @@
  */
 
 #include "Pyramid.h"
+#include "PyramidArena.h"
+
+Size pyramidLevelSize(Size size) {
+    return Size((size.width + 1) / 2, (size.height + 1) / 2);
+}
+
+size_t maxLevelNumber(Size size) {
+    size_t level_number = 0;
+    
+    while (size.width > 1 || size.height > 1) {
+        size = pyramidLevelSize(size);
+        ++level_number;
+    }
+    
+    return level_number;
+}
+
+int laplacianDepth(int depth) {
+    switch (depth) {
+        case CV_8U:
+        case CV_16S:
+            return CV_16S;
+        case CV_32F:
+        case CV_64F:
+            return depth;
+        default:
+            throw runtime_error("Pyramids need CV_8U, CV_16S, CV_32F or CV_64F images");
+    }
+}
 
 void createGaussianPyramid(const Mat& input_image, vector<Mat>& gauss_pyramid, size_t level_number) {
-    gauss_pyramid.clear();
+    // a new arena each call, so the levels do not share memory with the last pyramid returned
+    PyramidArena arena;
+    arena.buildGaussian(input_image, level_number);
+    
+    gauss_pyramid = arena.levels();
+}
+
+void createLaplacianPyramid(const vector<Mat>& gauss_pyramid, vector<Mat>& laplac_pyramid) {
+    PyramidArena arena;
+    arena.buildLaplacian(gauss_pyramid);
     
-    Mat source = input_image;
-    gauss_pyramid.push_back(source);
+    laplac_pyramid = arena.levels();
+}
+
+Mat reconstruct(const vector<Mat>& laplac_pyramid, int aLevel) {
+    Mat reconstruction;
     
-    for (unsigned int i = 0; i < level_number; ++i) {
-        Mat dst;
-        pyrDown(source, dst, Size(source.cols / 2, source.rows / 2));
+    if (aLevel >= 0 && (size_t) aLevel < laplac_pyramid.size()) {
+        reconstructProgressive(laplac_pyramid, [&](const Mat& image, size_t level) {
+            reconstruction = image;
+            
+            return level > (size_t) aLevel;
+        });
+    }
+    
+    return reconstruction;
+}
+
+void reconstructProgressive(const vector<Mat>& laplac_pyramid, const function<bool(const Mat&, size_t)>& on_level) {
+    if (laplac_pyramid.empty()) {
+        return;
+    }
+    
+    // two buffers the size of the largest level, each level collapses from one into a view of the other
+    const Mat& base = laplac_pyramid.back();
+    int type = base.type();
+    Mat buffers[2] = { Mat(1, base.rows * base.cols, type), Mat(1, base.rows * base.cols, type) };
+    Mat reconstruction;
+    
+    for (size_t i = 0; i < laplac_pyramid.size(); ++i) {
+        const Mat& level = laplac_pyramid[i];
+        Mat next = buffers[i % 2].colRange(0, level.rows * level.cols).reshape(0, level.rows);
         
-        gauss_pyramid.push_back(dst);
+        if (i == 0) {
+            level.copyTo(next);
+        } else {
+            // to the finer level's exact size, which is one less than double when it was odd
+            pyrUp(reconstruction, next, level.size());
+            add(next, level, next);
+        }
+        
+        reconstruction = next;
         
-        source = dst;
+        if (!on_level(reconstruction, laplac_pyramid.size() - 1 - i)) {
+            return;
+        }
     }
 }
 
-void createLaplacianPyramid(const vector<Mat>& gauss_pyramid, vector<Mat>& laplac_pyramid) {
-    laplac_pyramid.clear();
+void reconstructLevels(const vector<Mat>& laplac_pyramid, vector<Mat>& reconstructions) {
+    reconstructions.resize(laplac_pyramid.size());
+    
+    for (size_t i = 0; i < laplac_pyramid.size(); ++i) {
+        const Mat& level = laplac_pyramid[i];
+        
+        if (i == 0) {
+            level.copyTo(reconstructions[i]);
+        } else {
+            pyrUp(reconstructions[i - 1], reconstructions[i], level.size());
+            add(reconstructions[i], level, reconstructions[i]);
+        }
+    }
+}
 
-    unsigned int last_id(gauss_pyramid.size());
+Mat reconstructPreview(const vector<Mat>& laplac_pyramid, int max_width) {
+    size_t last = 0;
+    
+    while (last + 1 < laplac_pyramid.size() && laplac_pyramid[last + 1].cols <= max_width) {
+        ++last;
+    }
+    
+    return reconstruct(laplac_pyramid, (int) (laplac_pyramid.size() - 1 - last));
+}
 
-    Mat source = gauss_pyramid[--last_id];
-    laplac_pyramid.push_back(source);
+// output += image_2 + weight * (image_1 - image_2), with one weight per pixel for all channels
+static void addBlendedFloat(const Mat& image_1, const Mat& image_2, const Mat& weights, Mat& output) {
+    int channels = image_1.channels();
+    
+    for (int y = 0; y < image_1.rows; ++y) {
+        const float* row_1 = image_1.ptr<float>(y);
+        const float* row_2 = image_2.ptr<float>(y);
+        const float* row_weights = weights.ptr<float>(y);
+        float* row_output = output.ptr<float>(y);
+        
+        for (int x = 0, i = 0; x < image_1.cols; ++x) {
+            float weight = row_weights[x];
+            
+            for (int c = 0; c < channels; ++c, ++i) {
+                row_output[i] += row_2[i] + weight * (row_1[i] - row_2[i]);
+            }
+        }
+    }
+}
 
-    for (unsigned int i = 0; i < gauss_pyramid.size() - 1; ++i) {
-        Mat dst;
-        pyrUp(source, dst, Size(source.cols*2, source.rows*2));
+// the same on CV_16S levels, with CV_8U weights scaled to 0-256 so 255 takes all of image_1
+static void addBlendedFixed(const Mat& image_1, const Mat& image_2, const Mat& weights, Mat& output) {
+    int channels = image_1.channels();
+    
+    for (int y = 0; y < image_1.rows; ++y) {
+        const short* row_1 = image_1.ptr<short>(y);
+        const short* row_2 = image_2.ptr<short>(y);
+        const uchar* row_weights = weights.ptr<uchar>(y);
+        short* row_output = output.ptr<short>(y);
+        
+        for (int x = 0, i = 0; x < image_1.cols; ++x) {
+            int weight = row_weights[x] + (row_weights[x] >> 7);
+            
+            for (int c = 0; c < channels; ++c, ++i) {
+                int mixed = row_2[i] + ((weight * (row_1[i] - row_2[i]) + 128) >> 8);
+                row_output[i] = saturate_cast<short>(row_output[i] + mixed);
+            }
+        }
+    }
+}
 
-        source = gauss_pyramid[--last_id];
-        Mat pushtest = source - dst;
-        laplac_pyramid.push_back(pushtest);
+Mat blend(const Mat& image_1, const Mat& image_2, const Mat& mask, size_t level_number) {
+    if (image_1.size() != image_2.size() || image_1.size() != mask.size()) {
+        throw runtime_error("Images and mask do not have the same size");
     }
+    if (image_1.type() != image_2.type() || (image_1.depth() != CV_32F && image_1.depth() != CV_8U)) {
+        throw runtime_error("Images must both be the same CV_32F or CV_8U type");
+    }
+    
+    PyramidArena arena_1;
+    PyramidArena arena_2;
+    arena_1.buildLaplacian(image_1, level_number);
+    arena_2.buildLaplacian(image_2, level_number);
+    
+    return blend(arena_1.levels(), arena_2.levels(), mask);
 }
 
-Mat reconstruct(const vector<Mat>& laplac_pyramid, int aLevel) {
+Mat blend(const vector<Mat>& lapl_pyramid_1, const vector<Mat>& lapl_pyramid_2, const Mat& mask) {
+    if (lapl_pyramid_1.empty() || lapl_pyramid_1.size() != lapl_pyramid_2.size()) {
+        throw runtime_error("Pyramids do not have the same number of levels");
+    }
+    for (size_t i = 0; i < lapl_pyramid_1.size(); ++i) {
+        if (lapl_pyramid_1[i].size() != lapl_pyramid_2[i].size() || lapl_pyramid_1[i].type() != lapl_pyramid_2[i].type()) {
+            throw runtime_error("Pyramids do not have the same level sizes and type");
+        }
+    }
+    
+    const Mat& base = lapl_pyramid_1.back();
+    if (base.size() != mask.size()) {
+        throw runtime_error("Mask is not the size of the pyramids' base");
+    }
+    if (base.depth() != CV_32F && base.depth() != CV_16S) {
+        throw runtime_error("Pyramids must be CV_32F or the CV_16S of a CV_8U image");
+    }
+    if (mask.channels() != 1 || (mask.depth() != CV_32F && mask.depth() != CV_8U)) {
+        throw runtime_error("Mask must be a single channel CV_32F or CV_8U image");
+    }
+    
+    // the weights are kept in the images' path, 0 to 1 for float and 0 to 255 for fixed point
+    bool fixed_point = base.depth() == CV_16S;
+    Mat weights = mask;
+    if (fixed_point && mask.depth() == CV_32F) {
+        mask.convertTo(weights, CV_8U, 255);
+    } else if (!fixed_point && mask.depth() == CV_8U) {
+        mask.convertTo(weights, CV_32F, 1.0 / 255);
+    }
+    
+    PyramidArena arena_mask;
+    arena_mask.buildGaussian(weights, lapl_pyramid_1.size() - 1);
+    
+    const vector<Mat>& mask_pyramid = arena_mask.levels();
+    size_t last = mask_pyramid.size() - 1;
+    
+    // two full size buffers, each level collapses from one into a view of the other
+    int type = base.type();
+    Mat buffers[2] = { Mat(1, base.rows * base.cols, type), Mat(1, base.rows * base.cols, type) };
     Mat reconstruction;
     
-    if(laplac_pyramid.size()) {
-        for (int i = 0; i < laplac_pyramid.size() - aLevel; ++i) {
-            if (i == 0) {
-                reconstruction = laplac_pyramid[i];
-            } else {
-                Mat dst;
-                pyrUp(reconstruction, dst, Size(reconstruction.cols * 2, reconstruction.rows * 2));
-                
-                reconstruction = dst + laplac_pyramid[i];
-            }
+    for (size_t i = 0; i <= last; ++i) {
+        Size size = lapl_pyramid_1[i].size();
+        Mat next = buffers[i % 2].colRange(0, size.area()).reshape(0, size.height);
+        
+        // the laplacian pyramids run smallest first and the mask pyramid base first
+        if (i == 0) {
+            next.setTo(Scalar::all(0));
+        } else {
+            pyrUp(reconstruction, next, size);
+        }
+        if (fixed_point) {
+            addBlendedFixed(lapl_pyramid_1[i], lapl_pyramid_2[i], mask_pyramid[last - i], next);
+        } else {
+            addBlendedFloat(lapl_pyramid_1[i], lapl_pyramid_2[i], mask_pyramid[last - i], next);
         }
+        
+        reconstruction = next;
+    }
+    
+    if (fixed_point) {
+        reconstruction.convertTo(reconstruction, CV_8UC(base.channels()));
     }
     
     return reconstruction;
 }
 
-
 Mat visualisePyramid(const vector<Mat>& pyramid) {
     cv::Scalar background_colour(51, 184, 34, 255);
     cv::Mat window_data(256, 256, CV_8UC3, background_colour);
@@ -88,8 +272,9 @@ Mat visualisePyramid(const vector<Mat>& pyramid) {
             ascending = false;
         }
         
-        window_data = Mat(tmp.rows * 1.5 + EDGE * 2.0,
-                          tmp.cols  + EDGE * (pyramid.size() + 1),
+        // odd sizes round up each level, so leave a pixel per level for the rounding
+        window_data = Mat(tmp.rows + (tmp.rows + 1) / 2 + EDGE * 2,
+                          tmp.cols  + (EDGE + 1) * (pyramid.size() + 1),
                           CV_8UC3,
                           background_colour);
         
@@ -142,10 +327,6 @@ void swapHalves(Mat& image_1, Mat& image_2) {
 }
 
 bool isPowerOfTwo(int i) {
-    if (i % 2 == 0) {
-        return true;
-    } else {
-        return false;
-    }
+    return i > 0 && (i & (i - 1)) == 0;
 }
 
@@ -0,0 +1,138 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       PyramidArena.cxx
+ *
+ *   @brief      Handle laying the levels of a pyramid out in one allocation and building them in one sweep
+ *
+ *   @date       11/02/21
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include "PyramidArena.h"
+#include "Pyramid.h"
+
+// every level starts on a multiple of this many bytes
+static const size_t ARENA_ALIGN = 64;
+
+static size_t gcd(size_t a, size_t b) {
+    while (b) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+
+    return a;
+}
+
+void PyramidArena::allocate(Size base, int type, size_t level_number, bool laplacian) {
+    size_t element_size = CV_ELEM_SIZE(type);
+    size_t align = ARENA_ALIGN / gcd(ARENA_ALIGN, element_size); // in elements
+
+    vector<Size> sizes;
+    vector<size_t> offsets;
+    size_t total = 0;
+    Size size = base;
+
+    for (size_t i = 0; i <= level_number; ++i) {
+        sizes.push_back(size);
+        offsets.push_back(total);
+
+        // a gaussian pyramid's base is the input itself, so only a laplacian one stores it
+        if (i > 0 || laplacian) {
+            total += (size.area() + align - 1) / align * align;
+        }
+        size = pyramidLevelSize(size);
+    }
+
+    // the block only grows, so a smaller pyramid reuses it as is
+    if (total > 0 && (storage_.type() != type || storage_.total() < total)) {
+        storage_.create(1, (int) total, type);
+    }
+    if (laplacian && (scratch_.type() != type || scratch_.total() < (size_t) base.area())) {
+        scratch_.create(1, base.area(), type);
+    }
+
+    storage_levels_.resize(sizes.size());
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        if (i == 0 && !laplacian) {
+            storage_levels_[i] = Mat();
+            continue;
+        }
+
+        Mat block = storage_.colRange((int) offsets[i], (int) (offsets[i] + sizes[i].area()));
+
+        // a single row is continuous, so it can be viewed as the level's rows
+        storage_levels_[i] = block.reshape(0, sizes[i].height);
+    }
+}
+
+void PyramidArena::buildGaussian(const Mat& input_image, size_t level_number) {
+    level_number = min(level_number, maxLevelNumber(input_image.size()));
+    allocate(input_image.size(), input_image.type(), level_number, false);
+
+    levels_.assign(storage_levels_.begin(), storage_levels_.end());
+    levels_[0] = input_image;
+
+    for (size_t i = 0; i < level_number; ++i) {
+        pyrDown(levels_[i], levels_[i + 1], levels_[i + 1].size());
+    }
+}
+
+void PyramidArena::buildLaplacian(const Mat& input_image, size_t level_number) {
+    level_number = min(level_number, maxLevelNumber(input_image.size()));
+    int depth = laplacianDepth(input_image.depth());
+    allocate(input_image.size(), CV_MAKETYPE(depth, input_image.channels()), level_number, true);
+
+    // level i holds the gaussian level until the one below it is made, then becomes the difference.
+    // A CV_8U image is widened first, and its gaussian levels are built in CV_16S, which rounds
+    // the same as CV_8U for values that fit in 8 bits
+    Mat source = input_image;
+    if (input_image.depth() != depth || level_number == 0) {
+        input_image.convertTo(storage_levels_[0], depth);
+        source = storage_levels_[0];
+    }
+
+    for (size_t i = 0; i < level_number; ++i) {
+        Mat& smaller = storage_levels_[i + 1];
+        Mat expanded(source.size(), source.type(), scratch_.data);
+
+        pyrDown(source, smaller, smaller.size());
+        pyrUp(smaller, expanded, expanded.size());
+        subtract(source, expanded, storage_levels_[i]);
+
+        source = smaller;
+    }
+
+    levels_.assign(storage_levels_.rbegin(), storage_levels_.rend());
+}
+
+void PyramidArena::buildLaplacian(const vector<Mat>& gauss_pyramid) {
+    levels_.clear();
+
+    if (gauss_pyramid.empty()) {
+        return;
+    }
+
+    const Mat& base = gauss_pyramid.front();
+    int depth = laplacianDepth(base.depth());
+    allocate(base.size(), CV_MAKETYPE(depth, base.channels()), gauss_pyramid.size() - 1, true);
+
+    size_t last = gauss_pyramid.size() - 1;
+    gauss_pyramid[last].convertTo(storage_levels_[last], depth);
+
+    for (size_t i = 0; i < last; ++i) {
+        const Mat& source = gauss_pyramid[i];
+
+        // expanded in the gaussian's own depth, which never takes more room than the scratch row's
+        Mat expanded(source.size(), source.type(), scratch_.data);
+
+        pyrUp(gauss_pyramid[i + 1], expanded, expanded.size());
+        subtract(source, expanded, storage_levels_[i], noArray(), depth);
+    }
+
+    levels_.assign(storage_levels_.rbegin(), storage_levels_.rend());
+}
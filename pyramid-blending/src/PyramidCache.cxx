@@ -0,0 +1,287 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       PyramidCache.cxx
+ *
+ *   @brief      Handle saving laplacian pyramids to disk and mapping them back in without copying
+ *
+ *   @date       11/02/21
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "PyramidCache.h"
+#include "PyramidArena.h"
+
+static const char PYRAMID_MAGIC[8] = { 'C', 'V', 'P', 'Y', 'R', 'A', 'M', '2' };
+
+// every level starts on a multiple of this many bytes, as in PyramidArena
+static const uint64 PYRAMID_ALIGN = 64;
+
+struct PyramidFileHeader {
+    char magic[8];
+    uint64 hash;
+    uint64 digest;
+    uint64 source_bytes;
+    int32_t type;
+    int32_t level_count;
+};
+
+struct PyramidFileLevel {
+    int32_t rows;
+    int32_t cols;
+    uint64 offset;
+};
+
+static string cache_directory;
+
+void enablePyramidCache(const string& directory) {
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        string error_message;
+        error_message  = "Could not create the pyramid cache \"";
+        error_message += directory;
+        error_message += "\".";
+
+        throw error_message;
+    }
+
+    cache_directory = directory;
+}
+
+bool pyramidCacheEnabled() {
+    return !cache_directory.empty();
+}
+
+// a word at a time: xor in, multiply up, and fold the high bits back down so every bit reaches every other.
+// The digest does the same with its own multiplier and fold, so it does not collide where the hash does
+static void hashBytes(PyramidKey& key, const uchar* data, size_t length) {
+    const uint64 HASH_MULTIPLIER = 0x9e3779b97f4a7c15ULL;
+    const uint64 DIGEST_MULTIPLIER = 0xc2b2ae3d27d4eb4fULL;
+    size_t i = 0;
+
+    for (; i + 8 <= length; i += 8) {
+        uint64 word;
+        memcpy(&word, data + i, 8);
+
+        key.hash = (key.hash ^ word) * HASH_MULTIPLIER;
+        key.hash ^= key.hash >> 32;
+        key.digest = (key.digest ^ word) * DIGEST_MULTIPLIER;
+        key.digest ^= key.digest >> 29;
+    }
+    for (; i < length; ++i) {
+        key.hash = (key.hash ^ data[i]) * HASH_MULTIPLIER;
+        key.hash ^= key.hash >> 32;
+        key.digest = (key.digest ^ data[i]) * DIGEST_MULTIPLIER;
+        key.digest ^= key.digest >> 29;
+    }
+
+    key.source_bytes += length;
+}
+
+static void hashValue(PyramidKey& key, uint64 value) {
+    hashBytes(key, (const uchar*) &value, sizeof(value));
+}
+
+PyramidKey pyramidKey(const Mat& image, size_t level_number) {
+    PyramidKey key;
+    key.hash = 0xcbf29ce484222325ULL;
+    key.digest = 0x27d4eb2f165667c5ULL;
+    hashValue(key, image.rows);
+    hashValue(key, image.cols);
+    hashValue(key, image.type());
+    hashValue(key, level_number);
+
+    for (int y = 0; y < image.rows; ++y) {
+        hashBytes(key, image.ptr(y), image.cols * image.elemSize());
+    }
+
+    return key;
+}
+
+PyramidKey pyramidKey(const string& image_filename, int type, size_t level_number) {
+    ifstream file(image_filename.c_str(), ios::binary);
+
+    if (!file) {
+        string error_message;
+        error_message  = "Could not open or find \"";
+        error_message += image_filename;
+        error_message += "\".";
+
+        throw error_message;
+    }
+
+    // seeded differently from the pixel key, so an encoded file never matches a decoded image
+    PyramidKey key;
+    key.hash = 0x84222325cbf29ce4ULL;
+    key.digest = 0x165667c527d4eb2fULL;
+    hashValue(key, type);
+    hashValue(key, level_number);
+
+    vector<char> chunk(1 << 20);
+    while (file.read(chunk.data(), chunk.size()) || file.gcount() > 0) {
+        hashBytes(key, (const uchar*) chunk.data(), (size_t) file.gcount());
+    }
+
+    return key;
+}
+
+static string pyramidFilename(const PyramidKey& key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.pyr", (unsigned long long) key.hash);
+
+    return cache_directory + "/" + name;
+}
+
+static uint64 alignOffset(uint64 offset) {
+    return (offset + PYRAMID_ALIGN - 1) / PYRAMID_ALIGN * PYRAMID_ALIGN;
+}
+
+bool loadCachedPyramid(const PyramidKey& key, CachedPyramid& pyramid) {
+    if (!pyramidCacheEnabled()) {
+        return false;
+    }
+
+    int file = open(pyramidFilename(key).c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+
+    // the header is checked against the whole key before anything is mapped. Anything that does
+    // not match is treated as a miss, and is written over once the pyramid is rebuilt
+    struct stat status;
+    PyramidFileHeader header;
+    if (fstat(file, &status) != 0 || (size_t) status.st_size < sizeof(header) ||
+        pread(file, &header, sizeof(header), 0) != (ssize_t) sizeof(header) ||
+        memcmp(header.magic, PYRAMID_MAGIC, sizeof(PYRAMID_MAGIC)) != 0 || header.hash != key.hash ||
+        header.digest != key.digest || header.source_bytes != key.source_bytes ||
+        header.type != (header.type & CV_MAT_TYPE_MASK) || header.level_count <= 0 ||
+        sizeof(header) + header.level_count * sizeof(PyramidFileLevel) > (size_t) status.st_size) {
+        close(file);
+        return false;
+    }
+
+    // private, so a level written to is copied rather than changing the file
+    size_t length = status.st_size;
+    void* data = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    close(file);
+
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    shared_ptr<void> mapping(data, [length](void* address) { munmap(address, length); });
+    const uchar* bytes = (const uchar*) data;
+
+    vector<Mat> levels;
+    size_t element_size = CV_ELEM_SIZE(header.type);
+
+    for (int i = 0; i < header.level_count; ++i) {
+        PyramidFileLevel level;
+        memcpy(&level, bytes + sizeof(header) + i * sizeof(level), sizeof(level));
+
+        if (level.rows <= 0 || level.cols <= 0 || level.offset % PYRAMID_ALIGN != 0 ||
+            level.offset + (uint64) level.rows * level.cols * element_size > length) {
+            return false;
+        }
+
+        levels.push_back(Mat(level.rows, level.cols, header.type, (uchar*) data + level.offset));
+    }
+
+    pyramid.levels_.swap(levels);
+    pyramid.mapping_ = mapping;
+
+    return true;
+}
+
+static void storeCachedPyramid(const PyramidKey& key, const vector<Mat>& levels) {
+    string filename = pyramidFilename(key);
+
+    // unique to this process and thread, so two writers of the same key never share a file
+    stringstream temporary;
+    temporary << filename << ".tmp." << getpid() << "." << hash<thread::id>()(this_thread::get_id());
+
+    PyramidFileHeader header;
+    memcpy(header.magic, PYRAMID_MAGIC, sizeof(PYRAMID_MAGIC));
+    header.hash = key.hash;
+    header.digest = key.digest;
+    header.source_bytes = key.source_bytes;
+    header.type = levels[0].type();
+    header.level_count = (int32_t) levels.size();
+
+    vector<PyramidFileLevel> table(levels.size());
+    uint64 offset = alignOffset(sizeof(header) + table.size() * sizeof(PyramidFileLevel));
+
+    for (size_t i = 0; i < levels.size(); ++i) {
+        table[i].rows = levels[i].rows;
+        table[i].cols = levels[i].cols;
+        table[i].offset = offset;
+
+        offset = alignOffset(offset + levels[i].total() * levels[i].elemSize());
+    }
+
+    ofstream file(temporary.str().c_str(), ios::binary);
+    file.write((const char*) &header, sizeof(header));
+    file.write((const char*) table.data(), table.size() * sizeof(PyramidFileLevel));
+
+    const char padding[PYRAMID_ALIGN] = {};
+    uint64 written = sizeof(header) + table.size() * sizeof(PyramidFileLevel);
+
+    for (size_t i = 0; i < levels.size(); ++i) {
+        file.write(padding, table[i].offset - written);
+        written = table[i].offset;
+
+        for (int y = 0; y < levels[i].rows; ++y) {
+            file.write((const char*) levels[i].ptr(y), levels[i].cols * levels[i].elemSize());
+        }
+        written += levels[i].total() * levels[i].elemSize();
+    }
+    file.close();
+
+    // the cache only saves time, so a pyramid that cannot be saved is still used
+    if (!file || rename(temporary.str().c_str(), filename.c_str()) != 0) {
+        cerr << "Could not save the pyramid \"" << filename << "\" to the cache" << endl;
+        remove(temporary.str().c_str());
+    }
+}
+
+void buildCachedPyramid(const Mat& image, size_t level_number, const PyramidKey& key, CachedPyramid& pyramid) {
+    // the arena's levels share its block's reference count, so they outlive it
+    PyramidArena arena;
+    arena.buildLaplacian(image, level_number);
+
+    pyramid.levels_ = arena.levels();
+    pyramid.mapping_.reset();
+
+    if (pyramidCacheEnabled()) {
+        storeCachedPyramid(key, pyramid.levels_);
+    }
+}
+
+void cachedLaplacianPyramid(const Mat& image, size_t level_number, CachedPyramid& pyramid) {
+    if (!pyramidCacheEnabled()) {
+        buildCachedPyramid(image, level_number, PyramidKey(), pyramid);
+        return;
+    }
+
+    PyramidKey key = pyramidKey(image, level_number);
+
+    if (!loadCachedPyramid(key, pyramid)) {
+        buildCachedPyramid(image, level_number, key, pyramid);
+    }
+}
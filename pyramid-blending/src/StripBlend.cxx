@@ -0,0 +1,173 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       StripBlend.cxx
+ *
+ *   @brief      Handle blending raw images a strip at a time, keeping only a window of rows in memory
+ *
+ *   @date       11/02/21
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "StripBlend.h"
+#include "Pyramid.h"
+#include "Stats.h"
+
+int64 stripHalo(size_t level_number) {
+    // pyrDown reaches 2 rows and pyrUp 1 row of the level below, in that level's rows,
+    // so down to the smallest level and back up is just under 4 << level_number full size rows.
+    // Past 60 levels that no longer fits, but no image has that many
+    return (int64) 4 << min<size_t>(level_number, 60);
+}
+
+static int64 roundUp(int64 value, int64 multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+/**
+ * Read the next rows of a raw file into a continuous Mat.
+ */
+static void readRows(ifstream& input, Mat rows, const string& filename) {
+    ScopedTimer timer(STAGE_IMREAD);
+    size_t bytes = rows.total() * rows.elemSize();
+
+    input.read((char*) rows.data, bytes);
+    if ((size_t) input.gcount() != bytes) {
+        string error_message;
+        error_message  = "\"";
+        error_message += filename;
+        error_message += "\" ended early. Is the size right?";
+
+        throw error_message;
+    }
+}
+
+static void openInput(ifstream& input, const string& filename) {
+    input.open(filename.c_str(), ios::binary);
+
+    if (!input) {
+        string error_message;
+        error_message  = "Could not open or find \"";
+        error_message += filename;
+        error_message += "\".";
+
+        throw error_message;
+    }
+}
+
+void blendStrips(const string& image_1_filename, const string& image_2_filename, const string& mask_filename,
+                 const string& output_filename, Size size, size_t level_number, int strip_rows, bool fixed_point) {
+    ifstream input_1;
+    ifstream input_2;
+    ifstream input_mask;
+    openInput(input_1, image_1_filename);
+    openInput(input_2, image_2_filename);
+    openInput(input_mask, mask_filename);
+
+    ofstream output_file;
+    if (output_filename != "-") {
+        output_file.open(output_filename.c_str(), ios::binary);
+
+        if (!output_file) {
+            string error_message;
+            error_message  = "Could not open the output \"";
+            error_message += output_filename;
+            error_message += "\".";
+
+            throw error_message;
+        }
+    }
+    ostream& output = output_filename == "-" ? cout : output_file;
+
+    // the whole image blend stops at a 1x1 level, so the strips must too
+    level_number = min(level_number, maxLevelNumber(size));
+
+    // strips and halos start on multiples of the smallest level, so every level lines up with the whole image's.
+    // The last strip ends where the image does, so its levels round the same way too
+    int64 align = (int64) 1 << level_number;
+    int64 halo_rows = stripHalo(level_number);
+    int64 core_rows = roundUp(strip_rows > 0 ? strip_rows : halo_rows, align);
+
+    // a halo reaching past the image means every strip would hold all of it, so it is blended as one strip
+    if (halo_rows >= size.height) {
+        core_rows = size.height;
+    }
+    int halo = (int) min<int64>(halo_rows, size.height);
+    int core = (int) min<int64>(core_rows, size.height);
+    int capacity = (int) min<int64>(core_rows + 2 * halo_rows, size.height);
+
+    // the window of rows held in memory, rows [window_start, window_end) of the image
+    Mat window_1(capacity, size.width, CV_8UC3);
+    Mat window_2(capacity, size.width, CV_8UC3);
+    Mat window_mask(capacity, size.width, CV_8UC1);
+    int window_start = 0;
+    int window_end = 0;
+
+    Mat float_1, float_2;
+    Mat result;
+    Mat strip;
+
+    cerr << "blending " << size.width << "x" << size.height << " in strips of " << core << " rows with "
+         << halo << " rows of halo (" << capacity << " rows held)" << endl;
+
+    for (int core_start = 0; core_start < size.height; core_start += core) {
+        int core_end = min(size.height, core_start + core);
+        int start = max(0, core_start - halo);
+        int end = min(size.height, core_end + halo);
+
+        // slide the rows still needed to the top, then read the new ones below them
+        int kept = max(0, window_end - start);
+        if (kept > 0 && start > window_start) {
+            int shift = start - window_start;
+            memmove(window_1.data, window_1.ptr(shift), kept * window_1.step[0]);
+            memmove(window_2.data, window_2.ptr(shift), kept * window_2.step[0]);
+            memmove(window_mask.data, window_mask.ptr(shift), kept * window_mask.step[0]);
+        }
+
+        readRows(input_1, window_1.rowRange(kept, end - start), image_1_filename);
+        readRows(input_2, window_2.rowRange(kept, end - start), image_2_filename);
+        readRows(input_mask, window_mask.rowRange(kept, end - start), mask_filename);
+        window_start = start;
+        window_end = end;
+
+        Mat rows_1 = window_1.rowRange(0, end - start);
+        Mat rows_2 = window_2.rowRange(0, end - start);
+        Mat rows_mask = window_mask.rowRange(0, end - start);
+
+        if (!fixed_point) {
+            rows_1.convertTo(float_1, CV_32FC3);
+            rows_2.convertTo(float_2, CV_32FC3);
+            rows_1 = float_1;
+            rows_2 = float_2;
+        }
+
+        {
+            ScopedTimer timer(STAGE_BLEND);
+            result = blend(rows_1, rows_2, rows_mask, level_number);
+        }
+
+        // write this strip's own rows, leaving the halos to the strips either side
+        result(Rect(0, core_start - start, size.width, core_end - core_start)).convertTo(strip, CV_8UC3);
+        {
+            ScopedTimer timer(STAGE_IMWRITE);
+            for (int y = 0; y < strip.rows; ++y) {
+                output.write((const char*) strip.ptr(y), strip.cols * strip.elemSize());
+            }
+        }
+
+        if (!output) {
+            throw runtime_error("Could not write the blended rows");
+        }
+    }
+
+    output.flush();
+}
@@ -0,0 +1,229 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       WeightedBlend.cxx
+ *
+ *   @brief      Handle blending any number of images through their weight maps into one pair of pyramids
+ *
+ *   @date       11/02/21
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <exception>
+
+#include "WeightedBlend.h"
+#include "Pyramid.h"
+
+// weight sums below this are treated as no weight, rather than amplifying rounding noise
+static const float MIN_WEIGHT_SUM = 1e-6f;
+
+// sum += level * weight, with one weight per pixel for all channels
+static void addWeightedLevel(const Mat& level, const Mat& weights, Mat& sum) {
+    int channels = level.channels();
+
+    for (int y = 0; y < level.rows; ++y) {
+        const float* row_level = level.ptr<float>(y);
+        const float* row_weights = weights.ptr<float>(y);
+        float* row_sum = sum.ptr<float>(y);
+
+        for (int x = 0, i = 0; x < level.cols; ++x) {
+            float weight = row_weights[x];
+
+            for (int c = 0; c < channels; ++c, ++i) {
+                row_sum[i] += weight * row_level[i];
+            }
+        }
+    }
+}
+
+// output = sum / weight_sum, or 0 where nothing was weighted
+static void normaliseLevel(const Mat& sum, const Mat& weight_sum, Mat& output) {
+    int channels = sum.channels();
+    output.create(sum.size(), sum.type());
+
+    for (int y = 0; y < sum.rows; ++y) {
+        const float* row_sum = sum.ptr<float>(y);
+        const float* row_weight_sum = weight_sum.ptr<float>(y);
+        float* row_output = output.ptr<float>(y);
+
+        for (int x = 0, i = 0; x < sum.cols; ++x) {
+            float scale = row_weight_sum[x] > MIN_WEIGHT_SUM ? 1.0f / row_weight_sum[x] : 0.0f;
+
+            for (int c = 0; c < channels; ++c, ++i) {
+                row_output[i] = row_sum[i] * scale;
+            }
+        }
+    }
+}
+
+void BlendAccumulator::add(const Mat& image, const Mat& weight) {
+    if (image.size() != weight.size()) {
+        throw runtime_error("Image and weight map do not have the same size");
+    }
+    if (image.depth() != CV_32F && image.depth() != CV_8U) {
+        throw runtime_error("Images must be CV_32F or CV_8U");
+    }
+    if (weight.channels() != 1 || (weight.depth() != CV_32F && weight.depth() != CV_8U)) {
+        throw runtime_error("Weight map must be a single channel CV_32F or CV_8U image");
+    }
+    if (!sum_.empty() && (image.size() != sum_.back().size() || image.channels() != sum_.back().channels())) {
+        throw runtime_error("Images do not all have the same size and channels");
+    }
+
+    // converted into buffers kept between images, so the same size allocates nothing
+    Mat image_float = image;
+    if (image.depth() != CV_32F) {
+        image.convertTo(image_float_, CV_32F);
+        image_float = image_float_;
+    }
+    Mat weight_float = weight;
+    if (weight.depth() != CV_32F) {
+        weight.convertTo(weight_float_, CV_32F, 1.0 / 255);
+        weight_float = weight_float_;
+    }
+
+    image_arena_.buildLaplacian(image_float, level_number_);
+    weight_arena_.buildGaussian(weight_float, level_number_);
+
+    const vector<Mat>& lapl_pyramid = image_arena_.levels();
+    const vector<Mat>& weight_pyramid = weight_arena_.levels();
+    size_t last = weight_pyramid.size() - 1;
+
+    if (sum_.empty()) {
+        sum_.resize(lapl_pyramid.size());
+        weight_sum_.resize(lapl_pyramid.size());
+
+        for (size_t i = 0; i < lapl_pyramid.size(); ++i) {
+            sum_[i] = Mat::zeros(lapl_pyramid[i].size(), lapl_pyramid[i].type());
+            weight_sum_[i] = Mat::zeros(lapl_pyramid[i].size(), CV_32F);
+        }
+    }
+
+    // the laplacian pyramid runs smallest first and the weight pyramid base first
+    for (size_t i = 0; i <= last; ++i) {
+        addWeightedLevel(lapl_pyramid[i], weight_pyramid[last - i], sum_[i]);
+        cv::add(weight_sum_[i], weight_pyramid[last - i], weight_sum_[i]);
+    }
+
+    ++count_;
+}
+
+void BlendAccumulator::merge(const BlendAccumulator& other) {
+    if (other.sum_.empty()) {
+        return;
+    }
+    if (sum_.empty()) {
+        level_number_ = other.level_number_;
+        sum_.resize(other.sum_.size());
+        weight_sum_.resize(other.weight_sum_.size());
+
+        for (size_t i = 0; i < other.sum_.size(); ++i) {
+            other.sum_[i].copyTo(sum_[i]);
+            other.weight_sum_[i].copyTo(weight_sum_[i]);
+        }
+    } else {
+        if (other.sum_.size() != sum_.size() || other.sum_.back().size() != sum_.back().size() ||
+            other.sum_.back().type() != sum_.back().type()) {
+            throw runtime_error("Accumulators do not have the same levels");
+        }
+
+        for (size_t i = 0; i < sum_.size(); ++i) {
+            cv::add(sum_[i], other.sum_[i], sum_[i]);
+            cv::add(weight_sum_[i], other.weight_sum_[i], weight_sum_[i]);
+        }
+    }
+
+    count_ += other.count_;
+}
+
+Mat BlendAccumulator::result() const {
+    if (sum_.empty()) {
+        throw runtime_error("Nothing has been added to blend");
+    }
+
+    vector<Mat> lapl_pyramid(sum_.size());
+    for (size_t i = 0; i < sum_.size(); ++i) {
+        normaliseLevel(sum_[i], weight_sum_[i], lapl_pyramid[i]);
+    }
+
+    return reconstruct(lapl_pyramid, 0);
+}
+
+Mat blendWeighted(size_t image_count, const function<void(size_t, Mat&, Mat&)>& load, size_t level_number,
+                  size_t threads) {
+    if (image_count == 0) {
+        throw runtime_error("Nothing to blend");
+    }
+
+    if (threads == 0) {
+        threads = thread::hardware_concurrency();
+    }
+    threads = max<size_t>(1, min(threads, image_count));
+
+    vector<BlendAccumulator> accumulators(threads, BlendAccumulator(level_number));
+    vector<exception_ptr> errors(threads);
+    atomic<size_t> next_image(0);
+
+    auto work = [&](size_t t) {
+        try {
+            Mat image;
+            Mat weight;
+
+            for (size_t i = next_image++; i < image_count; i = next_image++) {
+                load(i, image, weight);
+                accumulators[t].add(image, weight);
+            }
+        } catch (...) {
+            // stop the other threads taking more images, the error is rethrown once they finish
+            errors[t] = current_exception();
+            next_image = image_count;
+        }
+    };
+
+    if (threads == 1) {
+        work(0);
+    } else {
+        // the threads already keep every core busy with whole images, as in the batch mode
+        int opencv_threads = getNumThreads();
+        setNumThreads(1);
+
+        vector<thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.push_back(thread(work, t));
+        }
+        for (size_t t = 0; t < threads; ++t) {
+            workers[t].join();
+        }
+
+        setNumThreads(opencv_threads);
+    }
+
+    for (size_t t = 0; t < threads; ++t) {
+        if (errors[t]) {
+            rethrow_exception(errors[t]);
+        }
+    }
+
+    for (size_t t = 1; t < threads; ++t) {
+        accumulators[0].merge(accumulators[t]);
+    }
+
+    return accumulators[0].result();
+}
+
+Mat blendWeighted(const vector<Mat>& images, const vector<Mat>& weights, size_t level_number, size_t threads) {
+    if (images.size() != weights.size()) {
+        throw runtime_error("Every image needs one weight map");
+    }
+
+    return blendWeighted(images.size(), [&](size_t i, Mat& image, Mat& weight) {
+        image = images[i];
+        weight = weights[i];
+    }, level_number, threads);
+}
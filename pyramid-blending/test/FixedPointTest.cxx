@@ -0,0 +1,117 @@
+/**
+ ********************************************************************************
+ *
+ *   @file       FixedPointTest.cxx
+ *
+ *   @brief      Checks the fixed point pyramids against the error bounds documented in Pyramid.h
+ *
+ *   @date       11/02/21
+ *
+ *   @author     Max Petts
+ *
+ ********************************************************************************
+ */
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+#include "Pyramid.h"
+#include "PyramidArena.h"
+
+// the same as Blending
+static const size_t LEVELS = 8;
+
+/**
+ * A 3 channel CV_8U image of crossing gradients and ripples, the same on every run.
+ *
+ * @param size: The size of the image.
+ * @param phase: Shifts the pattern, so two images can differ.
+ */
+static Mat syntheticImage(Size size, float phase) {
+    Mat image(size, CV_8UC3);
+
+    for (int y = 0; y < size.height; y++) {
+        uchar* row = image.ptr<uchar>(y);
+        float v = (float) y / size.height;
+
+        for (int x = 0; x < size.width; x++) {
+            float u = (float) x / size.width;
+            float ripple = 32 * sin(40 * (u + v) + phase);
+
+            row[3 * x] = saturate_cast<uchar>(255 * u);
+            row[3 * x + 1] = saturate_cast<uchar>(255 * v);
+            row[3 * x + 2] = saturate_cast<uchar>(128 + ripple);
+        }
+    }
+
+    return image;
+}
+
+/**
+ * A soft diagonal seam, so every level has a real mix of both images.
+ */
+static Mat syntheticMask(Size size) {
+    Mat mask(size, CV_8U);
+
+    for (int y = 0; y < mask.rows; y++) {
+        uchar* row = mask.ptr<uchar>(y);
+        for (int x = 0; x < mask.cols; x++) {
+            row[x] = saturate_cast<uchar>(255 * (0.5f + (float) (x - y) / mask.cols));
+        }
+    }
+
+    return mask;
+}
+
+/**
+ * Reconstruct and blend one size on the fixed point path and compare it with the bounds.
+ *
+ * @return true if both are within them.
+ */
+static bool checkSize(Size size) {
+    Mat image_1 = syntheticImage(size, 0);
+    Mat image_2 = syntheticImage(size, 1.5f);
+    Mat mask = syntheticMask(size);
+
+    // both ways of building the pyramid must reconstruct exactly
+    vector<Mat> gauss_pyramid, lapl_pyramid;
+    createGaussianPyramid(image_1, gauss_pyramid, LEVELS);
+    createLaplacianPyramid(gauss_pyramid, lapl_pyramid);
+
+    PyramidArena arena;
+    arena.buildLaplacian(image_1, LEVELS);
+
+    Mat reconstruction, fused_reconstruction;
+    reconstruct(lapl_pyramid, 0).convertTo(reconstruction, CV_8UC3);
+    reconstruct(arena.levels(), 0).convertTo(fused_reconstruction, CV_8UC3);
+    double reconstruct_error = max(norm(reconstruction, image_1, NORM_INF),
+                                   norm(fused_reconstruction, image_1, NORM_INF));
+
+    // the blend against the float path on the same 8-bit images
+    Mat float_1, float_2, float_blend;
+    image_1.convertTo(float_1, CV_32FC3);
+    image_2.convertTo(float_2, CV_32FC3);
+    blend(float_1, float_2, mask, LEVELS).convertTo(float_blend, CV_8UC3);
+
+    Mat fixed_blend = blend(image_1, image_2, mask, LEVELS);
+    double blend_error = norm(fixed_blend, float_blend, NORM_INF);
+
+    bool within = reconstruct_error == 0 && blend_error <= FIXED_POINT_BLEND_ERROR;
+    cout << size.width << "x" << size.height << ": reconstruct off by " << reconstruct_error
+         << ", blend off by " << blend_error << " (up to " << FIXED_POINT_BLEND_ERROR << " allowed): "
+         << (within ? "ok" : "FAILED") << endl;
+
+    return within;
+}
+
+int main() {
+    bool passed = true;
+
+    // small enough to run in a moment, odd sizes included so every level rounds up somewhere
+    passed &= checkSize(Size(64, 48));
+    passed &= checkSize(Size(97, 61));
+    passed &= checkSize(Size(33, 129));
+
+    return passed ? 0 : 1;
+}